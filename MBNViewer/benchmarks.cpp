@@ -0,0 +1,892 @@
+#include "benchmarks.h"
+#include "simdkernels.h"
+#include "signalprocessor.h"
+#include "iirfilter.h"
+#include "envelopemethods.h"
+#include "slidingstats.h"
+#include "parallelpeaks.h"
+#include "streamingpeaks.h"
+#include "kiss_fft.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Best-of-N wall time of fn in nanoseconds
+static qint64 bestOf(int repeats, const std::function<void()> &fn)
+{
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int r = 0; r < repeats; ++r) {
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        best = std::min(best, timer.nsecsElapsed());
+    }
+    return best;
+}
+
+static std::vector<double> noise(std::size_t n, unsigned seed)
+{
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> dist(0.0, 1.0);
+    std::vector<double> v(n);
+    for (double &x : v)
+        x = dist(rng);
+    return v;
+}
+
+static bool benchAveraging(QTextStream &out)
+{
+    bool identical = true;
+    const SimdLevel best = detectedSimdLevel();
+    out << "== Channel averaging (" << simdLevelName(best) << " available) ==\n";
+
+    const int shapes[][2] = { { 100000, 5 }, { 1000000, 5 }, { 4000000, 5 }, { 100000, 32 } };
+    for (const auto &shape : shapes) {
+        const int rows = shape[0], cols = shape[1];
+        const std::vector<double> raw = noise(std::size_t(rows) * cols, 1);
+        std::vector<double> ref(rows), vec(rows);
+        const int repeats = rows > 1000000 ? 5 : 20;
+
+        const qint64 tScalar = bestOf(repeats, [&] {
+            averageRepeatBlocks(raw.data(), rows, cols, ref.data(), SimdLevel::Scalar);
+        });
+        out << QString("%1 x %2").arg(rows).arg(cols).leftJustified(16)
+            << QString("scalar %1 ns/row").arg(double(tScalar) / rows, 0, 'f', 3);
+
+        for (SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2 }) {
+            if (level > best)
+                continue;
+            const qint64 t = bestOf(repeats, [&] {
+                averageRepeatBlocks(raw.data(), rows, cols, vec.data(), level);
+            });
+            const bool same = std::memcmp(ref.data(), vec.data(), sizeof(double) * rows) == 0;
+            identical = identical && same;
+            out << QString("  %1 %2 ns/row (x%3%4)")
+                       .arg(simdLevelName(level))
+                       .arg(double(t) / rows, 0, 'f', 3)
+                       .arg(double(tScalar) / double(t), 0, 'f', 2)
+                       .arg(same ? "" : ", MISMATCH");
+        }
+        out << "\n";
+    }
+    return identical;
+}
+
+// The 2nd-order low-pass as butterworthFilter used to run it: coefficients designed per
+// call and two branches per sample
+static void legacyButterworth(const double *x, double *y, int n, double cutoffHz, double fs)
+{
+    double Wn  = std::tan(M_PI * cutoffHz / fs);
+    double Wn2 = Wn * Wn;
+    double norm = 1.0 + std::sqrt(2.0) * Wn + Wn2;
+    double b0 = Wn2 / norm, b1 = 2.0 * b0, b2 = b0;
+    double a1 = 2.0 * (Wn2 - 1.0) / norm;
+    double a2 = (1.0 - std::sqrt(2.0) * Wn + Wn2) / norm;
+    for (int i = 0; i < n; ++i) {
+        double yv = b0 * x[i];
+        if (i > 0) yv += b1 * x[i - 1] - a1 * y[i - 1];
+        if (i > 1) yv += b2 * x[i - 2] - a2 * y[i - 2];
+        y[i] = yv;
+    }
+}
+
+static bool benchIIR(QTextStream &out)
+{
+    out << "== Envelope low-pass, 1000 signals x 10000 samples ==\n";
+    const int signalCount = 1000, n = 10000;
+    const std::vector<double> x = noise(std::size_t(n), 2);
+    std::vector<double> ref(n), y(n);
+
+    const qint64 tLegacy = bestOf(5, [&] {
+        for (int s = 0; s < signalCount; ++s)
+            legacyButterworth(x.data(), ref.data(), n, 20.0, 10000.0);
+    });
+    out << QString("legacy order 2").leftJustified(22)
+        << QString("%1 ns/sample\n").arg(double(tLegacy) / (double(signalCount) * n), 0, 'f', 3);
+
+    double maxDiff = 0.0;
+    for (int order : { 2, 4, 8 }) {
+        const IIRFilter lowpass = envelopeLowpass(order, 20.0, 10000.0);
+        const qint64 t = bestOf(5, [&] {
+            for (int s = 0; s < signalCount; ++s)
+                lowpass.apply(x.data(), y.data(), n);
+        });
+        if (order == 2) {
+            for (int i = 0; i < n; ++i)
+                maxDiff = std::max(maxDiff, std::abs(y[i] - ref[i]));
+        }
+        out << QString("SOS order %1 (%2 sec)").arg(order).arg(lowpass.sections().size()).leftJustified(22)
+            << QString("%1 ns/sample").arg(double(t) / (double(signalCount) * n), 0, 'f', 3)
+            << (order == 2 ? QString(" (x%1, max |diff| %2)")
+                                 .arg(double(tLegacy) / double(t), 0, 'f', 2)
+                                 .arg(maxDiff, 0, 'g', 3)
+                           : QString())
+            << "\n";
+    }
+    // DF2T and the old direct form round differently; anything beyond that is a bug
+    return maxDiff < 1e-9;
+}
+
+static bool benchIIRBatch(QTextStream &out)
+{
+    bool identical = true;
+    const SimdLevel best = detectedSimdLevel();
+    out << "== Batch low-pass across signals (" << simdLevelName(best) << " available), "
+        << "64 signals x 10000 samples ==\n";
+
+    const int signalCount = 64, n = 10000;
+    QVector<QVector<double>> input(signalCount);
+    for (int s = 0; s < signalCount; ++s) {
+        const std::vector<double> x = noise(std::size_t(n), 3 + s);
+        input[s] = QVector<double>(x.begin(), x.end());
+    }
+
+    for (int order : { 2, 4 }) {
+        const IIRFilter lowpass = envelopeLowpass(order, 20.0, 10000.0);
+        QVector<QVector<double>> ref = input;
+        const qint64 tSingle = bestOf(3, [&] {
+            for (int s = 0; s < signalCount; ++s)
+                lowpass.apply(input[s].constData(), ref[s].data(), n);
+        });
+        out << QString("order %1").arg(order).leftJustified(10)
+            << QString("one at a time %1 ns/sample").arg(double(tSingle) / (double(signalCount) * n), 0, 'f', 3);
+
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+            if (level > best)
+                continue;
+            setActiveSimdLevel(level);
+            // The input copy is made outside the timed region
+            QVector<QVector<double>> y;
+            qint64 t = std::numeric_limits<qint64>::max();
+            for (int r = 0; r < 3; ++r) {
+                y = input;
+                for (QVector<double> &v : y)
+                    v.detach();
+                t = std::min(t, bestOf(1, [&] { lowpass.applyBatch(y); }));
+            }
+            const bool same = y == ref;
+            identical = identical && same;
+            out << QString("  %1 lanes %2 ns/sample (x%3%4)")
+                       .arg(simdLevelName(level))
+                       .arg(double(t) / (double(signalCount) * n), 0, 'f', 3)
+                       .arg(double(tSingle) / double(t), 0, 'f', 2)
+                       .arg(same ? "" : ", MISMATCH");
+        }
+        setActiveSimdLevel(best);
+        out << "\n";
+    }
+    return identical;
+}
+
+static bool benchEnvelope(QTextStream &out)
+{
+    const int signalCount = 32, n = 100000;
+    out << "== Envelope detector, " << signalCount << " signals x " << n << " samples ==\n";
+
+    MBNMatrix mbn(signalCount);
+    for (int s = 0; s < signalCount; ++s) {
+        const std::vector<double> x = noise(std::size_t(n), 100 + s);
+        mbn[s] = DoubleVector(x.begin(), x.end());
+    }
+    const IIRFilter lowpass = envelopeLowpass(2, 20.0, 10000.0);
+    const double samples = double(signalCount) * n;
+
+    // The previous implementation: three passes and three vectors per signal
+    MBNMatrix legacy;
+    const qint64 tLegacy = bestOf(3, [&] {
+        legacy.clear();
+        for (const DoubleVector &x1 : mbn) {
+            DoubleVector x2(n), y(n), env(n);
+            for (int j = 0; j < n; ++j)
+                x2[j] = 2.0 * x1[j] * x1[j];
+            legacyButterworth(x2.constData(), y.data(), n, 20.0, 10000.0);
+            for (int j = 0; j < n; ++j)
+                env[j] = 2.0 * std::sqrt(std::max(0.0, y[j]));
+            legacy << env;
+        }
+    });
+
+    // Square / batch filter / sqrt as separate passes over the whole matrix
+    MBNMatrix ref;
+    const qint64 tPasses = bestOf(3, [&] {
+        ref.clear();
+        for (const DoubleVector &x1 : mbn) {
+            DoubleVector x2(n);
+            for (int j = 0; j < n; ++j)
+                x2[j] = 2.0 * x1[j] * x1[j];
+            ref << x2;
+        }
+        lowpass.applyBatch(ref);
+        for (DoubleVector &env : ref)
+            for (double &y : env)
+                y = 2.0 * std::sqrt(std::max(0.0, y));
+    });
+
+    // Fused, into preallocated buffers (as envelopesInto reuses them between calls)
+    MBNMatrix single(signalCount, DoubleVector(n));
+    const qint64 tSingle = bestOf(3, [&] {
+        for (int s = 0; s < signalCount; ++s)
+            envelopeInto(lowpass, mbn[s].constData(), single[s].data(), n);
+    });
+    MBNMatrix batch;
+    envelopesInto(lowpass, mbn, batch);
+    const qint64 tBatch = bestOf(3, [&] { envelopesInto(lowpass, mbn, batch); });
+
+    double legacyDiff = 0.0;
+    for (int s = 0; s < signalCount; ++s)
+        for (int j = 0; j < n; ++j)
+            legacyDiff = std::max(legacyDiff, std::abs(legacy[s][j] - ref[s][j]) / std::max(1e-300, std::abs(ref[s][j])));
+    const bool same = single == ref && batch == ref;
+
+    auto line = [&](const char *name, qint64 t) {
+        out << QString(name).leftJustified(28)
+            << QString("%1 ns/sample (x%2)\n").arg(double(t) / samples, 0, 'f', 3)
+                                              .arg(double(tLegacy) / double(t), 0, 'f', 2);
+    };
+    line("legacy (3 vectors/signal)", tLegacy);
+    line("square/batch filter/sqrt", tPasses);
+    line("fused, one signal", tSingle);
+    line("fused, SIMD lanes", tBatch);
+    out << QString("fused == separate passes: %1; legacy max rel. diff %2\n")
+               .arg(same ? "yes" : "NO")
+               .arg(legacyDiff, 0, 'g', 3);
+    return same;
+}
+
+// Hilbert envelope the straightforward way: power-of-two padding, plans allocated per call
+static DoubleVector naiveHilbertEnvelope(const DoubleVector &x)
+{
+    const int n = x.size();
+    int nfft = 1;
+    while (nfft < n)
+        nfft *= 2;
+    std::vector<kiss_fft_cpx> z(nfft), Z(nfft);
+    for (int j = 0; j < nfft; ++j) {
+        z[j].r = kiss_fft_scalar(j < n ? x[j] : 0.0);
+        z[j].i = 0;
+    }
+    kiss_fft_cfg forward = kiss_fft_alloc(nfft, 0, nullptr, nullptr);
+    kiss_fft(forward, z.data(), Z.data());
+    kiss_fft_free(forward);
+    for (int k = nfft / 2 + 1; k < nfft; ++k)
+        Z[k].r = Z[k].i = 0;
+    for (int k = 1; k < nfft / 2; ++k) {
+        Z[k].r *= 2;
+        Z[k].i *= 2;
+    }
+    kiss_fft_cfg inverse = kiss_fft_alloc(nfft, 1, nullptr, nullptr);
+    kiss_fft(inverse, Z.data(), z.data());
+    kiss_fft_free(inverse);
+    DoubleVector env(n);
+    for (int j = 0; j < n; ++j)
+        env[j] = 2.0 * std::hypot(double(z[j].r), double(z[j].i)) / nfft;
+    return env;
+}
+
+static bool benchHilbert(QTextStream &out)
+{
+    const int signalCount = 32, n = 100000;
+    out << "== Hilbert vs square-law envelope, " << signalCount << " signals x " << n << " samples ==\n";
+
+    MBNMatrix mbn(signalCount);
+    for (int s = 0; s < signalCount; ++s) {
+        const std::vector<double> x = noise(std::size_t(n), 300 + s);
+        mbn[s] = DoubleVector(x.begin(), x.end());
+    }
+    const IIRFilter lowpass = envelopeLowpass(2, 20.0, 10000.0);
+    const double samples = double(signalCount) * n;
+
+    MBNMatrix squareLaw;
+    envelopesInto(lowpass, mbn, squareLaw);
+    const qint64 tCausal = bestOf(3, [&] { envelopesInto(lowpass, mbn, squareLaw); });
+    const qint64 tZeroPhase = bestOf(3, [&] { squareLaw = extractEnvelopes(mbn, EnvelopeMode::ZeroPhase); });
+
+    MBNMatrix naive, hilbert, smoothed;
+    const qint64 tNaive = bestOf(3, [&] {
+        naive.clear();
+        for (const DoubleVector &x : mbn)
+            naive << naiveHilbertEnvelope(x);
+    });
+    const qint64 tHilbert = bestOf(3, [&] { hilbert = extractEnvelopesHilbert(mbn); });
+    const qint64 tSmoothed = bestOf(3, [&] {
+        smoothed = extractEnvelopesHilbert(mbn, kDefaultMBNSampleRate, kEnvelopeCutoffHz);
+    });
+
+    // The two Hilbert versions pad differently, so they only agree away from the ends
+    double diff = 0.0, peak = 0.0;
+    for (int s = 0; s < signalCount; ++s)
+        for (int j = n / 10; j < n - n / 10; ++j) {
+            diff = std::max(diff, std::abs(naive[s][j] - hilbert[s][j]));
+            peak = std::max(peak, std::abs(naive[s][j]));
+        }
+    const bool close = diff <= 1e-2 * peak;
+
+    auto line = [&](const char *name, qint64 t) {
+        out << QString(name).leftJustified(34)
+            << QString("%1 ns/sample (x%2)\n").arg(double(t) / samples, 0, 'f', 3)
+                                              .arg(double(tNaive) / double(t), 0, 'f', 2);
+    };
+    line("square-law, causal (SIMD lanes)", tCausal);
+    line("square-law, zero-phase", tZeroPhase);
+    line("Hilbert, 2^k size, plan per call", tNaive);
+    line("Hilbert, cached plans, 2/3/5 size", tHilbert);
+    line("Hilbert + 200 Hz zero-phase smooth", tSmoothed);
+    out << QString("Hilbert versions agree in the interior: %1 (max diff %2 of peak %3)\n")
+               .arg(close ? "yes" : "NO")
+               .arg(diff, 0, 'g', 3)
+               .arg(peak, 0, 'g', 3);
+    return close;
+}
+
+// Capture files named on the command line, for benchmarks that also run on real data
+static QStringList captureFiles;
+
+// Cost and deviation from reference of every registered envelope method on one data set.
+// The deviation is the RMS difference over all samples relative to the reference's peak.
+static bool compareEnvelopeMethods(QTextStream &out, const MBNMatrix &mbn, double fs,
+                                   const MBNMatrix &reference)
+{
+    double samples = 0.0, peak = 0.0;
+    for (const DoubleVector &r : reference) {
+        samples += r.size();
+        for (double v : r)
+            peak = std::max(peak, v);
+    }
+
+    bool ok = true;
+    for (const EnvelopeMethod &method : envelopeMethods()) {
+        EnvelopeParams params;
+        params.fs = fs;
+        MBNMatrix env;
+        double envelopeFs = fs;
+        const qint64 t = bestOf(3, [&] { env = method.extract(mbn, params, envelopeFs); });
+
+        double sumSq = 0.0;
+        for (int s = 0; s < reference.size(); ++s) {
+            if (s >= env.size() || env[s].size() != reference[s].size()) {
+                ok = false;
+                continue;
+            }
+            for (int j = 0; j < reference[s].size(); ++j)
+                sumSq += (env[s][j] - reference[s][j]) * (env[s][j] - reference[s][j]);
+        }
+        const double deviation = std::sqrt(sumSq / std::max(1.0, samples)) / std::max(1e-300, peak);
+        out << QString(method.name).leftJustified(12)
+            << QString("%1 ns/sample, deviation %2%\n").arg(double(t) / samples, 0, 'f', 3)
+                                                       .arg(100.0 * deviation, 0, 'f', 2);
+    }
+    return ok;
+}
+
+static bool benchEnvelopeMethods(QTextStream &out)
+{
+    // Synthetic bursts: Gaussian amplitude profiles a(t) on unit noise. The power of
+    // a*noise is a^2, so the envelope every method aims for is 2*sqrt(2*a^2).
+    const int signalCount = 16, n = 100000;
+    const double fs = kDefaultMBNSampleRate;
+    out << "== Envelope methods, synthetic bursts, " << signalCount << " signals x " << n
+        << " samples (reference: exact envelope) ==\n";
+    MBNMatrix mbn(signalCount), exact(signalCount);
+    for (int s = 0; s < signalCount; ++s) {
+        const std::vector<double> x = noise(std::size_t(n), 500 + s);
+        mbn[s].resize(n);
+        exact[s].resize(n);
+        const double centre = 0.2 + 0.6 * s / signalCount;
+        for (int j = 0; j < n; ++j) {
+            const double t = double(j) / n;
+            const double a = 0.05 + std::exp(-0.5 * std::pow((t - centre) / 0.03, 2))
+                             + 0.5 * std::exp(-0.5 * std::pow((t - 0.5) / 0.02, 2));
+            mbn[s][j] = a * x[std::size_t(j)];
+            exact[s][j] = 2.0 * std::sqrt(2.0) * a;
+        }
+    }
+    bool ok = compareEnvelopeMethods(out, mbn, fs, exact);
+
+    // Real captures have no ground truth: compare against the zero-phase square-law envelope
+    for (const QString &path : captureFiles) {
+        DoubleVector MBN;
+        CaptureLayout layout;
+        if (!processMBNStreaming(path, MBN, 16384, StreamProgress(), &layout)) {
+            out << "Cannot load " << path << "\n";
+            ok = false;
+            continue;
+        }
+        const double captureFs = layout.fs > 0.0 ? layout.fs : kDefaultMBNSampleRate;
+        const MBNMatrix capture{ MBN };
+        const MBNMatrix reference = extractEnvelopes(capture, envelopeLowpass(2, kEnvelopeCutoffHz, captureFs),
+                                                     EnvelopeMode::ZeroPhase);
+        out << "== Envelope methods, " << path << ", " << MBN.size()
+            << " samples (reference: zero-phase square-law) ==\n";
+        ok = compareEnvelopeMethods(out, capture, captureFs, reference) && ok;
+    }
+    return ok;
+}
+
+static bool benchSlidingStats(QTextStream &out)
+{
+    const int n = 1 << 20;
+    out << "== Sliding-window statistics, " << n << " samples, centred windows ==\n";
+    const std::vector<double> x = noise(std::size_t(n), 700);
+    std::vector<double> mean(n), meanSquare(n), max(n);
+
+    bool ok = true;
+    for (int window : { 101, 1001, 10001 }) {
+        const qint64 tMoments = bestOf(3, [&] {
+            slidingMoments(x.data(), n, window, WindowAlignment::Centred, mean.data(), meanSquare.data());
+        });
+        const qint64 tMax = bestOf(3, [&] {
+            slidingMax(x.data(), n, window, WindowAlignment::Centred, max.data());
+        });
+
+        // Direct O(window) evaluation of the first outputs, as reference and for scale
+        const int checked = std::min(n, 20000000 / window);
+        double worst = 0.0;
+        bool sameMax = true;
+        QElapsedTimer timer;
+        timer.start();
+        for (int j = 0; j < checked; ++j) {
+            const int lo = std::max(0, j - window / 2), hi = std::min(n - 1, j + window / 2);
+            double sum = 0.0, sumSq = 0.0, peak = x[std::size_t(lo)];
+            for (int k = lo; k <= hi; ++k) {
+                sum += x[std::size_t(k)];
+                sumSq += x[std::size_t(k)] * x[std::size_t(k)];
+                peak = std::max(peak, x[std::size_t(k)]);
+            }
+            const double count = hi - lo + 1, rms = std::sqrt(sumSq / count);
+            worst = std::max({ worst, std::abs(mean[j] - sum / count) / rms,
+                               std::abs(meanSquare[j] - sumSq / count) / (rms * rms) });
+            sameMax = sameMax && max[j] == peak;
+        }
+        const double tDirect = double(timer.nsecsElapsed()) / checked;
+        ok = ok && sameMax && worst < 1e-12;
+
+        out << QString("window %1: mean+mean square %2 Mwin/s, max %3 Mwin/s, direct %4 Mwin/s; "
+                       "max exact: %5, moments rel. error %6\n")
+                   .arg(window)
+                   .arg(1e3 * n / double(tMoments), 0, 'f', 0)
+                   .arg(1e3 * n / double(tMax), 0, 'f', 0)
+                   .arg(1e3 / tDirect, 0, 'f', 1)
+                   .arg(sameMax ? "yes" : "NO")
+                   .arg(worst, 0, 'g', 2);
+    }
+    return ok;
+}
+
+// findPeaksWithWidth as it used to be: every local maximum scans outwards for its
+// prominence, and every reported peak scans outwards for its half-maximum crossings
+static QVector<PeakInfo> legacyFindPeaks(const QVector<double> &signal, double fs, double minProminenceRatio)
+{
+    auto prominence = [&signal](int idx) {
+        const double peak = signal[idx];
+        double minLeft = peak, minRight = peak;
+        for (int L = idx - 1; L >= 0 && signal[L] < peak; --L)
+            minLeft = std::min(minLeft, signal[L]);
+        for (int R = idx + 1; R < signal.size() && signal[R] < peak; ++R)
+            minRight = std::min(minRight, signal[R]);
+        return peak - std::max(minLeft, minRight);
+    };
+
+    QVector<PeakInfo> peaks;
+    const int N = signal.size();
+    const double promThresh = *std::max_element(signal.constBegin(), signal.constEnd()) * minProminenceRatio;
+    for (int i = 1; i < N - 1; ++i) {
+        if (signal[i] > signal[i - 1] && signal[i] > signal[i + 1] && prominence(i) >= promThresh) {
+            const double half = signal[i] / 2.0;
+            int L = i, R = i;
+            while (L > 0 && signal[L] > half) --L;
+            while (R < N - 1 && signal[R] > half) ++R;
+            peaks.append({ signal[i], double(R - L) / fs, signal[i] * fs / double(R - L) });
+        }
+    }
+    if (signal[N - 1] > signal[N - 2] && prominence(N - 1) >= promThresh) {
+        const double half = signal[N - 1] / 2.0;
+        int L = N - 1;
+        while (L > 0 && signal[L] > half) --L;
+        peaks.append({ signal[N - 1], double(N - 1 - L) / fs, signal[N - 1] * fs / double(N - 1 - L) });
+    }
+    return peaks;
+}
+
+static bool benchProminence(QTextStream &out)
+{
+    out << "== Peak search with prominence and FWHM, adversarial inputs ==\n";
+
+    // noise: a local maximum every few samples. ramp: a slow rise with a ripple, so the
+    // left scan of every ripple peak runs back to the start. plateau: alternating 1.0 and
+    // 0.6, so every peak is prominent and lies above its half maximum all the way out.
+    struct Input {
+        const char *name;
+        double (*sample)(int i, int n, double noise);
+    };
+    const Input inputs[] = {
+        { "noise", [](int, int, double r) { return r; } },
+        { "ramp", [](int i, int n, double) { return double(i) / n + (i % 2 ? 1.0 : 0.0); } },
+        { "plateau", [](int i, int, double) { return i % 2 ? 1.0 : 0.6; } },
+    };
+
+    bool ok = true;
+    for (const Input &input : inputs) {
+        for (int n : { 12500, 25000, 50000, 1000000 }) {
+            const std::vector<double> r = noise(std::size_t(n), 900);
+            QVector<double> x(n);
+            for (int i = 0; i < n; ++i)
+                x[i] = input.sample(i, n, r[std::size_t(i)]);
+
+            QVector<PeakInfo> fast;
+            const qint64 tFast = bestOf(3, [&] { fast = findPeaksWithWidth(x, 100000.0, 0.2); });
+            QString legacyTime = "-";
+            if (n <= 50000) {
+                QVector<PeakInfo> legacy;
+                const qint64 tLegacy = bestOf(1, [&] { legacy = legacyFindPeaks(x, 100000.0, 0.2); });
+                bool same = legacy.size() == fast.size();
+                for (int p = 0; same && p < fast.size(); ++p)
+                    same = legacy[p].amplitude == fast[p].amplitude && legacy[p].fwhm == fast[p].fwhm;
+                ok = ok && same;
+                legacyTime = QString("%1 ms%2").arg(tLegacy / 1e6, 0, 'f', 2).arg(same ? "" : " (DIFFERENT)");
+            }
+            out << QString("%1 n=%2: %3 peaks, %4 ms (scanning: %5)\n")
+                       .arg(input.name).arg(n).arg(fast.size())
+                       .arg(tFast / 1e6, 0, 'f', 2).arg(legacyTime);
+        }
+    }
+    return ok;
+}
+
+// Field by field (bitwise for the doubles): the struct has padding after `count`
+static bool sameFeatures(const TimeDomainFeatures &a, const TimeDomainFeatures &b)
+{
+    const double da[] = { a.mean, a.meanAbs, a.rms, a.min, a.max, a.peak,
+                          a.crestFactor, a.variance, a.skewness, a.kurtosis };
+    const double db[] = { b.mean, b.meanAbs, b.rms, b.min, b.max, b.peak,
+                          b.crestFactor, b.variance, b.skewness, b.kurtosis };
+    return a.count == b.count && std::memcmp(da, db, sizeof da) == 0;
+}
+
+static bool benchFeatures(QTextStream &out)
+{
+    const SimdLevel best = detectedSimdLevel();
+    out << "== Time-domain features in one sweep (" << simdLevelName(best) << " available) ==\n";
+
+    bool ok = true;
+    for (int n : { 100000, 1000000, 8000000 }) {
+        // An offset signal, to check that the one-pass moments stay accurate
+        std::vector<double> r = noise(std::size_t(n), 1000);
+        for (double &v : r)
+            v = 50.0 + v * v * v;
+        const QVector<double> x(r.begin(), r.end());
+        const int repeats = n > 1000000 ? 3 : 10;
+
+        // What computeSignalFeatures used to do: mean/RMS, then max |x| for the ringing threshold
+        double meanAbs = 0.0, rms = 0.0, maxAbs = 0.0;
+        const qint64 tOld = bestOf(repeats, [&] {
+            double sumAbs = 0.0, sumSq = 0.0;
+            for (double v : x) {
+                sumAbs += std::abs(v);
+                sumSq += v * v;
+            }
+            meanAbs = sumAbs / n;
+            rms = std::sqrt(sumSq / n);
+            maxAbs = 0.0;
+            for (double v : x)
+                maxAbs = std::max(maxAbs, std::abs(v));
+        });
+
+        // Two-pass central moments as the accuracy reference
+        double mean = 0.0;
+        for (double v : x)
+            mean += v;
+        mean /= n;
+        double m2 = 0.0, m3 = 0.0, m4 = 0.0;
+        for (double v : x) {
+            const double d = v - mean;
+            m2 += d * d;
+            m3 += d * d * d;
+            m4 += d * d * d * d;
+        }
+        m2 /= n, m3 /= n, m4 /= n;
+        const double skew = m3 / std::pow(m2, 1.5), kurt = m4 / (m2 * m2);
+
+        out << QString("n=%1").arg(n).leftJustified(11)
+            << QString("separate passes %1 ms").arg(tOld / 1e6, 0, 'f', 2);
+        TimeDomainFeatures ref;
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+            if (level > best)
+                continue;
+            setActiveSimdLevel(level);
+            TimeDomainFeatures t;
+            const qint64 tNew = bestOf(repeats, [&] { t = timeDomainFeatures(x); });
+            if (level == SimdLevel::Scalar)
+                ref = t;
+            const bool same = sameFeatures(ref, t);
+            const double err = std::max({ std::abs(t.meanAbs / meanAbs - 1.0), std::abs(t.rms / rms - 1.0),
+                                          std::abs(t.skewness / skew - 1.0), std::abs(t.kurtosis / kurt - 1.0) });
+            ok = ok && same && t.peak == maxAbs && err < 1e-9;
+            out << QString(", %1 %2 ms (rel. error %3%4)")
+                       .arg(simdLevelName(level))
+                       .arg(tNew / 1e6, 0, 'f', 2)
+                       .arg(err, 0, 'g', 2)
+                       .arg(same ? "" : ", MISMATCH");
+        }
+        setActiveSimdLevel(best);
+        out << "\n";
+    }
+    return ok;
+}
+
+// countRingingAbove as it was: compare chains with plateau skipping, one sample at a time
+static int legacyCountRinging(const double *x, int N, double epsVal)
+{
+    int posCount = 0, negCount = 0;
+    if (x[0] > x[1] && x[0] > epsVal) ++posCount;
+    if (-x[0] > -x[1] && -x[0] > epsVal) ++negCount;
+    for (int i = 1; i < N - 1; ++i) {
+        if (x[i] > x[i - 1] && x[i] > x[i + 1] && x[i] > epsVal) {
+            ++posCount;
+            int j = i + 1; while (j < N && x[j] == x[i]) ++j;
+            i = j - 1;
+            continue;
+        }
+        double v = -x[i];
+        if (v > -x[i - 1] && v > -x[i + 1] && v > epsVal) {
+            ++negCount;
+            int j = i + 1; while (j < N && -x[j] == v) ++j;
+            i = j - 1;
+        }
+    }
+    if (x[N - 1] > x[N - 2] && x[N - 1] > epsVal) ++posCount;
+    if (-x[N - 1] > -x[N - 2] && -x[N - 1] > epsVal) ++negCount;
+    return static_cast<int>(std::ceil((posCount + negCount) / 2.0));
+}
+
+static bool benchExtrema(QTextStream &out)
+{
+    const SimdLevel best = detectedSimdLevel();
+    out << "== Local extrema for ringing and peak candidates (" << simdLevelName(best) << " available) ==\n";
+
+    // noise: raw MBN-like data. quantised: noise on a coarse ADC grid, full of flat runs.
+    // nan: noise with every 97th sample missing.
+    struct Input {
+        const char *name;
+        double (*sample)(double r, int i);
+    };
+    const Input inputs[] = {
+        { "noise", [](double r, int) { return r; } },
+        { "quantised", [](double r, int) { return std::round(r * 2.0) / 2.0; } },
+        { "nan", [](double r, int i) { return i % 97 ? r : std::numeric_limits<double>::quiet_NaN(); } },
+    };
+
+    bool ok = true;
+    for (const Input &input : inputs) {
+        for (int n : { 100000, 1000000 }) {
+            const std::vector<double> r = noise(std::size_t(n), 1100);
+            std::vector<double> x(r.size());
+            for (int i = 0; i < n; ++i)
+                x[std::size_t(i)] = input.sample(r[std::size_t(i)], i);
+            const double eps = 0.02 * 4.0;
+            const int repeats = 10;
+
+            int legacy = 0;
+            const qint64 tLegacy = bestOf(repeats, [&] { legacy = legacyCountRinging(x.data(), n, eps); });
+            std::vector<int> reference(std::size_t(n / 2 + 2)), index(reference.size());
+            const int refCount = localMaxima(x.data(), n, eps, reference.data(), SimdLevel::Scalar);
+
+            out << QString("%1 n=%2: ringing %3, scalar loop %4 ms")
+                       .arg(input.name).arg(n).arg(legacy).arg(tLegacy / 1e6, 0, 'f', 2);
+            for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+                if (level > best)
+                    continue;
+                setActiveSimdLevel(level);
+                int ringing = 0, count = 0;
+                const qint64 tCount = bestOf(repeats, [&] { ringing = countRingingAbove(x.data(), n, eps); });
+                const qint64 tFind = bestOf(repeats, [&] { count = localMaxima(x.data(), n, eps, index.data()); });
+                const bool same = ringing == legacy && count == refCount
+                               && std::equal(index.begin(), index.begin() + count, reference.begin());
+                ok = ok && same;
+                out << QString(", %1 count %2 ms / maxima %3 ms%4")
+                           .arg(simdLevelName(level))
+                           .arg(tCount / 1e6, 0, 'f', 2)
+                           .arg(tFind / 1e6, 0, 'f', 2)
+                           .arg(same ? "" : " (MISMATCH)");
+            }
+            setActiveSimdLevel(best);
+            out << "\n";
+        }
+    }
+    return ok;
+}
+
+static bool benchParallelPeaks(QTextStream &out)
+{
+    out << "== Chunked peak search and ringing count on " << QThread::idealThreadCount()
+        << " threads ==\n";
+
+    bool ok = true;
+    for (int n : { 4000000, 16000000 }) {
+        // Ringing on raw noise; peaks on a wandering envelope-like track with bursts
+        const std::vector<double> r = noise(std::size_t(n), 1200);
+        QVector<double> raw(r.begin(), r.end()), env(n);
+        double level = 0.0;
+        for (int i = 0; i < n; ++i) {
+            level += 0.01 * r[std::size_t(i)];
+            env[i] = std::abs(level) + (i % 5000 < 50 ? 3.0 : 0.0);
+        }
+
+        int ringSeq = 0, ringPar = 0;
+        QVector<PeakInfo> seq, par;
+        const qint64 tRingSeq = bestOf(3, [&] { ringSeq = countRingingByPeaks(raw, 0.02); });
+        const qint64 tRingPar = bestOf(3, [&] { ringPar = countRingingByPeaksParallel(raw, 0.02); });
+        const qint64 tPeakSeq = bestOf(3, [&] { seq = findPeaksWithWidth(env, 100000.0, 0.2); });
+        const qint64 tPeakPar = bestOf(3, [&] { par = findPeaksWithWidthParallel(env, 100000.0, 0.2); });
+
+        bool same = ringSeq == ringPar && seq.size() == par.size();
+        for (int k = 0; same && k < seq.size(); ++k)
+            same = std::memcmp(&seq[k], &par[k], sizeof(PeakInfo)) == 0;
+        ok = ok && same;
+        out << QString("n=%1: ringing %2 -> %3 ms, peaks (%4) %5 -> %6 ms%7\n")
+                   .arg(n)
+                   .arg(tRingSeq / 1e6, 0, 'f', 2).arg(tRingPar / 1e6, 0, 'f', 2)
+                   .arg(seq.size())
+                   .arg(tPeakSeq / 1e6, 0, 'f', 2).arg(tPeakPar / 1e6, 0, 'f', 2)
+                   .arg(same ? "" : " (DIFFERENT)");
+    }
+    return ok;
+}
+
+static bool benchStreamingPeaks(QTextStream &out)
+{
+    out << "== Streaming peak detector against findPeaksWithWidth ==\n";
+
+    bool ok = true;
+    for (int n : { 1000000, 10000000 }) {
+        // Envelope-like track with bursts, fed in acquisition-sized chunks
+        const std::vector<double> r = noise(std::size_t(n), 1300);
+        QVector<double> env(n);
+        double level = 0.0;
+        for (int i = 0; i < n; ++i) {
+            level = 0.999 * level + 0.05 * r[std::size_t(i)];
+            env[i] = std::abs(level) + (i % 20000 < 200 ? 2.0 : 0.0);
+        }
+        const double minProminence = 0.2 * *std::max_element(env.constBegin(), env.constEnd());
+
+        QVector<PeakInfo> batch;
+        const qint64 tBatch = bestOf(3, [&] { batch = findPeaksWithWidth(env, 100000.0, 0.2); });
+        QVector<StreamingPeakDetector::Peak> streamed;
+        StreamingPeakDetector detector;
+        const qint64 tStream = bestOf(3, [&] {
+            streamed.clear();
+            detector.reset(100000.0, minProminence, n);
+            for (int pos = 0; pos < n; pos += 5000)
+                detector.process(env.constData() + pos, std::min(5000, n - pos), streamed);
+            detector.finish(streamed);
+        });
+
+        std::sort(streamed.begin(), streamed.end(),
+                  [](const StreamingPeakDetector::Peak &a, const StreamingPeakDetector::Peak &b) {
+                      return a.position < b.position;
+                  });
+        bool same = batch.size() == streamed.size();
+        for (int k = 0; same && k < batch.size(); ++k)
+            same = std::memcmp(&batch[k], &streamed[k].info, sizeof(PeakInfo)) == 0;
+        ok = ok && same;
+        out << QString("n=%1: %2 peaks, batch %3 ms, streaming %4 ns/sample%5\n")
+                   .arg(n).arg(batch.size())
+                   .arg(tBatch / 1e6, 0, 'f', 2)
+                   .arg(double(tStream) / n, 0, 'f', 1)
+                   .arg(same ? "" : " (DIFFERENT)");
+    }
+    return ok;
+}
+
+static bool benchTopPeaks(QTextStream &out)
+{
+    out << "== Top-K peak selection against the full search ==\n";
+
+    // pulses: a decaying pulse of random height every 40 samples over a small noise floor,
+    // so most of the peaks are prominent. noise: |white noise|, a peak every few samples.
+    bool ok = true;
+    for (const char *input : { "pulses", "noise" }) {
+        const int n = 4000000;
+        const std::vector<double> r = noise(std::size_t(n), 1400);
+        QVector<double> env(n);
+        double pulse = 0.0;
+        for (int i = 0; i < n; ++i) {
+            if (input[0] == 'p') {
+                if (i % 40 == 0)
+                    pulse = 1.0 + std::abs(r[std::size_t(i)]);
+                pulse *= 0.9;
+                env[i] = pulse + 0.01 * std::abs(r[std::size_t(n - 1 - i)]);
+            } else {
+                env[i] = std::abs(r[std::size_t(i)]);
+            }
+        }
+
+        QVector<PeakInfo> all;
+        const qint64 tAll = bestOf(3, [&] { all = findPeaksWithWidth(env, 100000.0, 0.2); });
+        // What a caller had to do before: everything, then the K highest
+        std::stable_sort(all.begin(), all.end(),
+                         [](const PeakInfo &a, const PeakInfo &b) { return a.amplitude > b.amplitude; });
+        for (int k : { 10, 100, 1000 }) {
+            QVector<PeakInfo> top;
+            const qint64 tTop = bestOf(3, [&] { top = findTopPeaksWithWidth(env, 100000.0, 0.2, k); });
+            bool same = top.size() == std::min(k, int(all.size()));
+            for (int j = 0; same && j < top.size(); ++j)
+                same = std::memcmp(&top[j], &all[j], sizeof(PeakInfo)) == 0;
+            ok = ok && same;
+            out << QString("%1 n=%2 (%3 peaks) K=%4: top-K %5 ms, full search %6 ms%7\n")
+                       .arg(input).arg(n).arg(all.size()).arg(k)
+                       .arg(tTop / 1e6, 0, 'f', 2)
+                       .arg(tAll / 1e6, 0, 'f', 2)
+                       .arg(same ? "" : " (DIFFERENT)");
+        }
+    }
+    return ok;
+}
+
+struct Benchmark {
+    const char *name;
+    bool (*run)(QTextStream &out);
+};
+
+static const Benchmark kBenchmarks[] = {
+    { "averaging", benchAveraging },
+    { "iir", benchIIR },
+    { "iirbatch", benchIIRBatch },
+    { "envelope", benchEnvelope },
+    { "hilbert", benchHilbert },
+    { "methods", benchEnvelopeMethods },
+    { "sliding", benchSlidingStats },
+    { "prominence", benchProminence },
+    { "features", benchFeatures },
+    { "extrema", benchExtrema },
+    { "parallel", benchParallelPeaks },
+    { "streampeaks", benchStreamingPeaks },
+    { "topk", benchTopPeaks },
+};
+
+int runBenchmarks(const QStringList &names)
+{
+    QTextStream out(stdout);
+    QStringList selected;
+    for (const QString &name : names) {
+        if (name.endsWith(".db"))
+            captureFiles << name;
+        else
+            selected << name;
+    }
+
+    bool ok = true;
+    for (const Benchmark &b : kBenchmarks) {
+        if (!selected.isEmpty() && !selected.contains(QString::fromLatin1(b.name)))
+            continue;
+        ok = b.run(out) && ok;
+        out << Qt::endl;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <QStringList>
+
+// Headless micro-benchmarks, run as `MBNViewer --bench [name ...] [capture.db ...]`.
+// Without names every benchmark runs; results go to stdout. Arguments ending in .db are
+// captures for the benchmarks that also run on real data (methods). Returns the process exit code
+// (non-zero if an optimised path disagrees with its reference).
+int runBenchmarks(const QStringList &names);
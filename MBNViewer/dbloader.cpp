@@ -1,61 +1,823 @@
-#include "dbloader.h"
-#include <QDir>
-#include <QFileInfo>
-#include <QSqlDatabase>
-#include <QSqlQuery>
-#include <QSqlRecord>
-#include <QVariant>
-#include <QDebug>
-
-DBTableData loadAllDbFiles(const QString &dirPath)
-{
-    DBTableData dataList;
-
-    // Do only one thing: filter *.db files in dirPath directory, non-recursive
-    QDir dir(dirPath);
-    const QStringList filters{ "*.db" };
-    const QFileInfoList fileList = dir.entryInfoList(
-        filters, QDir::Files | QDir::NoDotAndDotDot | QDir::Readable);
-
-    for (const QFileInfo &fi : fileList) {
-        const QString dbFile = fi.absoluteFilePath();
-        const QString connName = dbFile; // Use absolute path as connection name to ensure uniqueness
-
-        {
-            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connName);
-            db.setDatabaseName(dbFile);
-            if (!db.open()) {
-                qWarning() << "Failed to open:" << dbFile;
-                QSqlDatabase::removeDatabase(connName);
-                continue;
-            }
-
-            TableData tableData;
-
-            {
-                QSqlQuery query(db);
-                if (!query.exec("SELECT * FROM data")) {
-                    qWarning() << "Query failed in:" << dbFile;
-                    db.close();
-                    QSqlDatabase::removeDatabase(connName);
-                    continue;
-                }
-
-                while (query.next()) {
-                    RowData row;
-                    const QSqlRecord rec = query.record();
-                    for (int i = 0; i < rec.count(); ++i)
-                        row << query.value(i);
-                    tableData << row;
-                }
-            } // QSqlQuery destructor
-
-            dataList << tableData;
-            db.close();
-        } // QSqlDatabase destructor
-
-        QSqlDatabase::removeDatabase(connName);
-    }
-
-    return dataList;
-}
+#include "dbloader.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QVariant>
+#include <QDebug>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtConcurrent>
+#include <QUrl>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include "sqlite3.h"
+
+DBTableData loadAllDbFiles(const QString &dirPath)
+{
+    DBTableData dataList;
+
+    // Do only one thing: filter *.db files in dirPath directory, non-recursive
+    QDir dir(dirPath);
+    const QStringList filters{ "*.db" };
+    const QFileInfoList fileList = dir.entryInfoList(
+        filters, QDir::Files | QDir::NoDotAndDotDot | QDir::Readable);
+
+    for (const QFileInfo &fi : fileList) {
+        const QString dbFile = fi.absoluteFilePath();
+        const QString connName = dbFile; // Use absolute path as connection name to ensure uniqueness
+
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connName);
+            db.setDatabaseName(dbFile);
+            if (!db.open()) {
+                qWarning() << "Failed to open:" << dbFile;
+                QSqlDatabase::removeDatabase(connName);
+                continue;
+            }
+
+            TableData tableData;
+
+            {
+                QSqlQuery query(db);
+                if (!query.exec("SELECT * FROM data")) {
+                    qWarning() << "Query failed in:" << dbFile;
+                    db.close();
+                    QSqlDatabase::removeDatabase(connName);
+                    continue;
+                }
+
+                while (query.next()) {
+                    RowData row;
+                    const QSqlRecord rec = query.record();
+                    for (int i = 0; i < rec.count(); ++i)
+                        row << query.value(i);
+                    tableData << row;
+                }
+            } // QSqlQuery destructor
+
+            dataList << tableData;
+            db.close();
+        } // QSqlDatabase destructor
+
+        QSqlDatabase::removeDatabase(connName);
+    }
+
+    return dataList;
+}
+
+static QString quotedIdentifier(const char *name)
+{
+    QString id = QString::fromUtf8(name);
+    id.replace(QString("\""), QString("\"\""));
+    return QString("\"%1\"").arg(id);
+}
+
+// Opens dbFile in place through a read-only, immutable URI and applies the bulk-read
+// profile. immutable=1 skips all locking and change detection, so this must not be
+// used on files that another process is still writing.
+static sqlite3 *openBulkReadOnly(const QString &dbFile)
+{
+    const QByteArray uri = QUrl::fromLocalFile(QFileInfo(dbFile).absoluteFilePath())
+                               .toString(QUrl::FullyEncoded).toUtf8()
+                           + "?mode=ro&immutable=1";
+
+    sqlite3 *db = nullptr;
+    if (sqlite3_open_v2(uri.constData(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, nullptr)
+        != SQLITE_OK) {
+        qWarning() << "Failed to open:" << dbFile << sqlite3_errmsg(db);
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    // 256 MB memory map, 64 MB page cache, no writes possible
+    sqlite3_exec(db,
+                 "PRAGMA mmap_size=268435456;"
+                 "PRAGMA cache_size=-65536;"
+                 "PRAGMA query_only=1;",
+                 nullptr, nullptr, nullptr);
+    return db;
+}
+
+static bool tableExists(sqlite3 *db, const char *name)
+{
+    sqlite3_stmt *stmt = nullptr;
+    bool found = false;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type='table' AND name=?",
+                           -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+        found = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Runs a single-row query; false if it fails or returns nothing
+static bool queryRow(sqlite3 *db, const char *sql, const std::function<void(sqlite3_stmt *)> &read)
+{
+    sqlite3_stmt *stmt = nullptr;
+    bool ok = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK
+              && sqlite3_step(stmt) == SQLITE_ROW;
+    if (ok)
+        read(stmt);
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+// Optional key/value table written by newer rigs: channels, record_length, fs, units
+static void readMetadata(sqlite3 *db, CaptureLayout &layout)
+{
+    if (!tableExists(db, "mbn_meta"))
+        return;
+
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT key, value FROM mbn_meta", -1, &stmt, nullptr) != SQLITE_OK)
+        return;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const QString key = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
+        if (key == "channels")
+            layout.channels = sqlite3_column_int(stmt, 1);
+        else if (key == "record_length")
+            layout.recordLength = sqlite3_column_int(stmt, 1);
+        else if (key == "fs")
+            layout.fs = sqlite3_column_double(stmt, 1);
+        else if (key == "units")
+            layout.units = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)));
+    }
+    sqlite3_finalize(stmt);
+}
+
+// Fills in whichever of channels/recordLength is missing and checks it against the row count
+static bool resolveShape(const QString &dbFile, CaptureLayout &layout)
+{
+    const qint64 n = layout.sampleCount;
+    if (layout.channels <= 0 && layout.recordLength > 0 && n % layout.recordLength == 0)
+        layout.channels = int(n / layout.recordLength);
+    if (layout.channels <= 0)
+        layout.channels = kDefaultMBNChannels;
+    if (layout.recordLength <= 0 && n % layout.channels == 0)
+        layout.recordLength = int(n / layout.channels);
+
+    if (n == 0 || qint64(layout.channels) * layout.recordLength != n) {
+        qWarning() << "Cannot split" << n << "samples into" << layout.channels << "channels of"
+                   << layout.recordLength << "samples:" << dbFile;
+        return false;
+    }
+    return true;
+}
+
+// Row-per-sample layout: pick the column from the declared schema
+static bool findSampleColumn(sqlite3 *db, const QString &dbFile, int column, CaptureLayout &layout)
+{
+    int columnCount = 0;
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "PRAGMA table_info(data)", -1, &stmt, nullptr) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            if (sqlite3_column_int(stmt, 0) == column)
+                layout.column = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)));
+            ++columnCount;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    // Same rule as processAllMBN: rows with less than 4 columns are not MBN rows
+    if (columnCount < 4 || layout.column.isEmpty()) {
+        qWarning() << "No MBN table in:" << dbFile;
+        return false;
+    }
+    return true;
+}
+
+static bool readLayout(sqlite3 *db, const QString &dbFile, int column, CaptureLayout &layout)
+{
+    layout = CaptureLayout();
+    readMetadata(db, layout);
+
+    if (tableExists(db, "mbn_channels")) {
+        layout.blob = true;
+        int channels = 0, minLength = 0, maxLength = 0;
+        double fs = 0.0;
+        queryRow(db, "SELECT count(*), min(samples), max(samples), max(fs) FROM mbn_channels",
+                 [&](sqlite3_stmt *stmt) {
+                     channels = sqlite3_column_int(stmt, 0);
+                     minLength = sqlite3_column_int(stmt, 1);
+                     maxLength = sqlite3_column_int(stmt, 2);
+                     fs = sqlite3_column_double(stmt, 3);
+                 });
+        if (channels <= 0 || minLength != maxLength) {
+            qWarning() << "Channels of unequal length in:" << dbFile;
+            return false;
+        }
+        layout.channels = channels;
+        layout.recordLength = minLength;
+        layout.sampleCount = qint64(channels) * minLength;
+        if (fs > 0.0)
+            layout.fs = fs;
+        return resolveShape(dbFile, layout);
+    }
+
+    if (!findSampleColumn(db, dbFile, column, layout))
+        return false;
+
+    if (!queryRow(db, "SELECT count(*) FROM data",
+                  [&](sqlite3_stmt *st) { layout.sampleCount = sqlite3_column_int64(st, 0); })) {
+        qWarning() << "Query failed in:" << dbFile << sqlite3_errmsg(db);
+        return false;
+    }
+    return resolveShape(dbFile, layout);
+}
+
+static void applyLayout(const CaptureLayout &layout, RawColumn &raw)
+{
+    raw.channels = layout.channels;
+    raw.recordLength = layout.recordLength;
+    raw.fs = layout.fs;
+    raw.units = layout.units;
+}
+
+// Row-per-sample layout: prepares a scan of the discovered column of table `data` only
+static sqlite3_stmt *prepareColumnScan(sqlite3 *db, const QString &dbFile, const CaptureLayout &layout)
+{
+    sqlite3_stmt *stmt = nullptr;
+    const QByteArray sql = QString("SELECT %1 FROM data")
+                               .arg(quotedIdentifier(layout.column.toUtf8().constData()))
+                               .toUtf8();
+    if (sqlite3_prepare_v2(db, sql.constData(), -1, &stmt, nullptr) != SQLITE_OK) {
+        qWarning() << "Query failed in:" << dbFile << sqlite3_errmsg(db);
+        return nullptr;
+    }
+    return stmt;
+}
+
+// Row-per-sample layout: one sample per row of table `data`, allocated once at the row count
+static bool readRowColumn(sqlite3 *db, const QString &dbFile, const CaptureLayout &layout,
+                          QVector<double> &out)
+{
+    sqlite3_stmt *stmt = prepareColumnScan(db, dbFile, layout);
+    if (!stmt)
+        return false;
+
+    out.reserve(layout.sampleCount);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+        out.append(sqlite3_column_double(stmt, 0));
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE || out.size() != layout.sampleCount) {
+        qWarning() << "Read failed in:" << dbFile;
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+// Appends `count` little-endian samples of a channel BLOB to out
+static bool appendBlobSamples(const void *blob, int bytes, const QString &dtype, int count,
+                              QVector<double> &out)
+{
+    const int offset = out.size();
+    if (dtype == "f64le") {
+        if (bytes != count * int(sizeof(double)))
+            return false;
+        out.resize(offset + count);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        std::memcpy(out.data() + offset, blob, size_t(bytes));
+#else
+        qFromLittleEndian<double>(blob, count, out.data() + offset);
+#endif
+        return true;
+    }
+    if (dtype == "f32le") {
+        if (bytes != count * int(sizeof(float)))
+            return false;
+        QVector<float> tmp(count);
+        qFromLittleEndian<float>(blob, count, tmp.data());
+        out.resize(offset + count);
+        std::copy(tmp.constBegin(), tmp.constEnd(), out.begin() + offset);
+        return true;
+    }
+    return false;
+}
+
+// Channel-BLOB layout: one row per channel in `mbn_channels`, channels concatenated in
+// index order so that the result has the same channel-major shape as the row layout
+static bool readBlobChannels(sqlite3 *db, const QString &dbFile, const CaptureLayout &layout,
+                             RawColumn &raw)
+{
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db,
+                           "SELECT units, dtype, samples, data FROM mbn_channels ORDER BY channel",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        qWarning() << "Query failed in:" << dbFile << sqlite3_errmsg(db);
+        return false;
+    }
+
+    raw.samples.reserve(layout.sampleCount);
+    int channel = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (channel == 0 && raw.units.isEmpty())
+            raw.units = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
+        const QString dtype = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)));
+        const int count = sqlite3_column_int(stmt, 2);
+        const void *blob = sqlite3_column_blob(stmt, 3);
+        const int bytes = sqlite3_column_bytes(stmt, 3);
+        if (!appendBlobSamples(blob, bytes, dtype, count, raw.samples)) {
+            qWarning() << "Corrupt channel BLOB in:" << dbFile << "channel" << channel;
+            rc = SQLITE_CORRUPT;
+            break;
+        }
+        ++channel;
+    }
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE) {
+        raw.samples.clear();
+        return false;
+    }
+    return true;
+}
+
+static bool readCapture(const QString &dbFile, RawColumn &raw, int column)
+{
+    raw.samples.clear();
+
+    sqlite3 *db = openBulkReadOnly(dbFile);
+    if (!db)
+        return false;
+
+    CaptureLayout layout;
+    bool ok = readLayout(db, dbFile, column, layout);
+    if (ok) {
+        applyLayout(layout, raw);
+        ok = layout.blob ? readBlobChannels(db, dbFile, layout, raw)
+                         : readRowColumn(db, dbFile, layout, raw.samples);
+    }
+    sqlite3_close(db);
+    return ok;
+}
+
+// Hand-over between the reader thread and the consumer: at most `capacity` chunks in flight
+class ChunkQueue {
+public:
+    explicit ChunkQueue(int capacity) : capacity(capacity) {}
+
+    // Producer side; returns false once the consumer has stopped
+    bool push(QVector<double> &&chunk)
+    {
+        QMutexLocker lock(&mutex);
+        while (chunks.size() >= capacity && !stopped)
+            notFull.wait(&mutex);
+        if (stopped)
+            return false;
+        chunks.append(std::move(chunk));
+        notEmpty.wakeOne();
+        return true;
+    }
+
+    void finish()
+    {
+        QMutexLocker lock(&mutex);
+        finished = true;
+        notEmpty.wakeOne();
+    }
+
+    // Consumer side; returns false when the producer is done and the queue is drained
+    bool pop(QVector<double> &chunk)
+    {
+        QMutexLocker lock(&mutex);
+        while (chunks.isEmpty() && !finished)
+            notEmpty.wait(&mutex);
+        if (chunks.isEmpty())
+            return false;
+        chunk = chunks.takeFirst();
+        notFull.wakeOne();
+        return true;
+    }
+
+    void stop()
+    {
+        QMutexLocker lock(&mutex);
+        stopped = true;
+        notFull.wakeOne();
+    }
+
+private:
+    QMutex mutex;
+    QWaitCondition notEmpty, notFull;
+    QList<QVector<double>> chunks;
+    const int capacity;
+    bool finished = false;
+    bool stopped = false;
+};
+
+// Reader side of streamDbFile: decodes the capture into chunks of at most chunkRows samples
+static bool produceChunks(sqlite3 *db, const QString &dbFile, int chunkRows,
+                          const CaptureLayout &layout, ChunkQueue &queue)
+{
+    QVector<double> chunk;
+    chunk.reserve(chunkRows);
+
+    if (layout.blob) {
+        sqlite3_stmt *stmt = nullptr;
+        if (sqlite3_prepare_v2(db, "SELECT dtype, samples, data FROM mbn_channels ORDER BY channel",
+                               -1, &stmt, nullptr) != SQLITE_OK) {
+            qWarning() << "Query failed in:" << dbFile << sqlite3_errmsg(db);
+            return false;
+        }
+
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            const QString dtype = QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
+            const int count = sqlite3_column_int(stmt, 1);
+            const char *blob = static_cast<const char *>(sqlite3_column_blob(stmt, 2));
+            const int bytes = sqlite3_column_bytes(stmt, 2);
+            const int width = dtype == "f32le" ? int(sizeof(float)) : int(sizeof(double));
+            if (count < 0 || bytes != count * width) {
+                qWarning() << "Corrupt channel BLOB in:" << dbFile;
+                rc = SQLITE_CORRUPT;
+                break;
+            }
+
+            for (int pos = 0; pos < count; pos += chunkRows) {
+                const int n = std::min(chunkRows, count - pos);
+                chunk.clear();
+                if (!appendBlobSamples(blob + qsizetype(pos) * width, n * width, dtype, n, chunk)) {
+                    rc = SQLITE_CORRUPT;
+                    break;
+                }
+                if (!queue.push(std::move(chunk))) {
+                    sqlite3_finalize(stmt);
+                    return true;  // consumer stopped early
+                }
+                chunk = QVector<double>();
+                chunk.reserve(chunkRows);
+            }
+            if (rc != SQLITE_ROW)
+                break;
+        }
+        sqlite3_finalize(stmt);
+        return rc == SQLITE_DONE;
+    }
+
+    sqlite3_stmt *stmt = prepareColumnScan(db, dbFile, layout);
+    if (!stmt)
+        return false;
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        chunk.append(sqlite3_column_double(stmt, 0));
+        if (chunk.size() == chunkRows) {
+            if (!queue.push(std::move(chunk))) {
+                sqlite3_finalize(stmt);
+                return true;  // consumer stopped early
+            }
+            chunk = QVector<double>();
+            chunk.reserve(chunkRows);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE) {
+        qWarning() << "Read failed in:" << dbFile;
+        return false;
+    }
+    if (!chunk.isEmpty())
+        queue.push(std::move(chunk));
+    return true;
+}
+
+bool streamDbFile(const QString &dbFile, const ChunkConsumer &consume, int chunkRows, int column,
+                  const LayoutConsumer &onLayout)
+{
+    chunkRows = std::max(1, chunkRows);
+
+    sqlite3 *db = openBulkReadOnly(dbFile);
+    if (!db)
+        return false;
+
+    CaptureLayout layout;
+    if (!readLayout(db, dbFile, column, layout) || (onLayout && !onLayout(layout))) {
+        sqlite3_close(db);
+        return false;
+    }
+
+    // Two chunks in flight: one being filled by the reader, one being consumed here
+    ChunkQueue queue(2);
+    bool readOk = false;
+    QThread *reader = QThread::create([&] {
+        readOk = produceChunks(db, dbFile, chunkRows, layout, queue);
+        queue.finish();
+    });
+    reader->start();
+
+    bool consumeOk = true;
+    QVector<double> chunk;
+    while (queue.pop(chunk)) {
+        if (!consume(chunk.constData(), chunk.size())) {
+            consumeOk = false;
+            queue.stop();
+            break;
+        }
+    }
+
+    reader->wait();
+    delete reader;
+    sqlite3_close(db);
+    return readOk && consumeOk;
+}
+
+bool discoverLayout(const QString &dbFile, CaptureLayout &layout, int column)
+{
+    sqlite3 *db = openBulkReadOnly(dbFile);
+    if (!db)
+        return false;
+    const bool ok = readLayout(db, dbFile, column, layout);
+    sqlite3_close(db);
+    return ok;
+}
+
+bool loadDbColumn(const QString &dbFile, QVector<double> &out, int column)
+{
+    RawColumn raw;
+    const bool ok = readCapture(dbFile, raw, column);
+    out = std::move(raw.samples);
+    return ok;
+}
+
+// *.db files in dirPath, non-recursive, sorted by name (ignoring case, as QDir does by
+// default)
+static QFileInfoList listDbFiles(const QString &dirPath)
+{
+    QDir dir(dirPath);
+    const QStringList filters{ "*.db" };
+    return dir.entryInfoList(filters, QDir::Files | QDir::NoDotAndDotDot | QDir::Readable,
+                             QDir::Name | QDir::IgnoreCase);
+}
+
+bool loadDbFile(const QString &dbFile, RawColumn &raw, int column)
+{
+    raw.source = QFileInfo(dbFile).absoluteFilePath();
+    return readCapture(raw.source, raw, column);
+}
+
+DBColumnData loadAllDbColumns(const QString &dirPath, int column)
+{
+    DBColumnData dataList;
+
+    const QFileInfoList fileList = listDbFiles(dirPath);
+    for (const QFileInfo &fi : fileList) {
+        RawColumn raw;
+        if (!loadDbFile(fi.absoluteFilePath(), raw, column))
+            continue;
+        dataList << raw;
+    }
+
+    return dataList;
+}
+
+DBColumnData loadAllDbColumnsParallel(const QString &dirPath, int maxThreads, int column)
+{
+    const QFileInfoList fileList = listDbFiles(dirPath);
+
+    // Bounded pool owned by this call so that a large batch cannot starve the global pool
+    QThreadPool pool;
+    pool.setMaxThreadCount(maxThreads > 0 ? maxThreads : QThread::idealThreadCount());
+
+    // Each task opens (and closes) its own sqlite3 connection on the worker thread;
+    // blockingMapped keeps the results in the order of fileList
+    const QList<RawColumn> loaded = QtConcurrent::blockingMapped(
+        &pool, fileList, [column](const QFileInfo &fi) {
+            RawColumn raw;
+            if (!loadDbFile(fi.absoluteFilePath(), raw, column))
+                raw.source.clear();  // mark as failed
+            return raw;
+        });
+
+    DBColumnData dataList;
+    dataList.reserve(loaded.size());
+    for (const RawColumn &raw : loaded) {
+        if (!raw.source.isEmpty())
+            dataList << raw;
+    }
+    return dataList;
+}
+
+bool convertDbToBlobLayout(const QString &srcFile, const QString &dstFile,
+                           const BlobConvertOptions &options)
+{
+    if (QFileInfo::exists(dstFile)
+        && QFileInfo(dstFile).canonicalFilePath() == QFileInfo(srcFile).canonicalFilePath()) {
+        qWarning() << "Refusing to convert a file onto itself:" << srcFile;
+        return false;
+    }
+
+    RawColumn raw;
+    if (!loadDbFile(srcFile, raw, options.column))
+        return false;
+    const QVector<double> &samples = raw.samples;
+
+    const int channels = options.channels > 0 ? options.channels : raw.channels;
+    if (channels <= 0 || samples.isEmpty() || samples.size() % channels != 0) {
+        qWarning() << "Cannot split" << samples.size() << "samples into" << channels
+                   << "channels:" << srcFile;
+        return false;
+    }
+    const int count = samples.size() / channels;
+    const double fs = options.fs > 0.0 ? options.fs : (raw.fs > 0.0 ? raw.fs : kDefaultMBNSampleRate);
+    const QByteArray units = (options.units.isEmpty() ? raw.units : options.units).toUtf8();
+
+    // Written without a journal, so only into a scratch file that nobody else reads
+    const QString partFile = dstFile + ".part";
+    if (QFile::exists(partFile) && !QFile::remove(partFile)) {
+        qWarning() << "Cannot replace:" << partFile;
+        return false;
+    }
+
+    sqlite3 *db = nullptr;
+    if (sqlite3_open_v2(partFile.toUtf8().constData(), &db,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+        qWarning() << "Failed to create:" << partFile << sqlite3_errmsg(db);
+        sqlite3_close(db);
+        QFile::remove(partFile);
+        return false;
+    }
+
+    bool ok = sqlite3_exec(db,
+                           "PRAGMA journal_mode=OFF;"
+                           "PRAGMA synchronous=OFF;"
+                           "BEGIN;"
+                           "CREATE TABLE mbn_channels ("
+                           " channel INTEGER PRIMARY KEY,"
+                           " fs      REAL    NOT NULL,"
+                           " units   TEXT,"
+                           " dtype   TEXT    NOT NULL,"
+                           " samples INTEGER NOT NULL,"
+                           " data    BLOB    NOT NULL);",
+                           nullptr, nullptr, nullptr) == SQLITE_OK;
+
+    sqlite3_stmt *stmt = nullptr;
+    ok = ok && sqlite3_prepare_v2(db,
+                                  "INSERT INTO mbn_channels (channel, fs, units, dtype, samples, data)"
+                                  " VALUES (?, ?, ?, ?, ?, ?)",
+                                  -1, &stmt, nullptr) == SQLITE_OK;
+
+    const char *dtype = options.float32 ? "f32le" : "f64le";
+    QByteArray blob;
+    for (int ch = 0; ok && ch < channels; ++ch) {
+        const double *src = samples.constData() + qsizetype(ch) * count;
+        if (options.float32) {
+            blob.resize(count * int(sizeof(float)));
+            float *dst = reinterpret_cast<float *>(blob.data());
+            for (int i = 0; i < count; ++i)
+                qToLittleEndian<float>(float(src[i]), dst + i);
+        } else {
+            blob.resize(count * int(sizeof(double)));
+            qToLittleEndian<double>(src, count, blob.data());
+        }
+
+        sqlite3_bind_int(stmt, 1, ch);
+        sqlite3_bind_double(stmt, 2, fs);
+        sqlite3_bind_text(stmt, 3, units.constData(), units.size(), SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, dtype, -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 5, count);
+        sqlite3_bind_blob(stmt, 6, blob.constData(), blob.size(), SQLITE_STATIC);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    ok = ok && sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok)
+        qWarning() << "Conversion failed:" << dstFile << sqlite3_errmsg(db);
+    sqlite3_close(db);
+
+    if (!ok) {
+        QFile::remove(partFile);
+        return false;
+    }
+    if (QFile::exists(dstFile) && !QFile::remove(dstFile)) {
+        qWarning() << "Cannot replace:" << dstFile;
+        QFile::remove(partFile);
+        return false;
+    }
+    if (!QFile::rename(partFile, dstFile)) {
+        qWarning() << "Cannot rename" << partFile << "to" << dstFile;
+        QFile::remove(partFile);
+        return false;
+    }
+    return true;
+}
+
+int convertDirToBlobLayout(const QString &srcDir, const QString &dstDir,
+                           const BlobConvertOptions &options, int maxThreads)
+{
+    const QFileInfoList fileList = listDbFiles(srcDir);
+    if (!QDir().mkpath(dstDir)) {
+        qWarning() << "Cannot create output directory:" << dstDir;
+        return 0;
+    }
+    const QDir out(dstDir);
+    if (out.canonicalPath() == QDir(srcDir).canonicalPath()) {
+        qWarning() << "Output directory must differ from the input:" << dstDir;
+        return 0;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(maxThreads > 0 ? maxThreads : QThread::idealThreadCount());
+
+    const QList<bool> done = QtConcurrent::blockingMapped(
+        &pool, fileList, [&](const QFileInfo &fi) {
+            return convertDbToBlobLayout(fi.absoluteFilePath(),
+                                         out.absoluteFilePath(fi.fileName()), options);
+        });
+    return int(std::count(done.constBegin(), done.constEnd(), true));
+}
+
+// —————————————— Live tail ——————————————
+
+DbTailReader::~DbTailReader()
+{
+    close();
+}
+
+bool DbTailReader::open(const QString &dbFile, int column)
+{
+    close();
+    source = QFileInfo(dbFile).absoluteFilePath();
+
+    // Plain read-only URI: unlike the bulk loaders this keeps locking and change detection,
+    // so every fetch sees the rows the writer has committed (in WAL mode without blocking it)
+    const QByteArray uri = QUrl::fromLocalFile(source).toString(QUrl::FullyEncoded).toUtf8()
+                           + "?mode=ro";
+    if (sqlite3_open_v2(uri.constData(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, nullptr)
+        != SQLITE_OK) {
+        qWarning() << "Failed to open:" << source << sqlite3_errmsg(db);
+        close();
+        return false;
+    }
+    sqlite3_busy_timeout(db, 200);
+    sqlite3_exec(db, "PRAGMA query_only=1;", nullptr, nullptr, nullptr);
+
+    // The row count is still growing, so the shape comes from mbn_meta or the defaults
+    captureLayout = CaptureLayout();
+    readMetadata(db, captureLayout);
+    if (!findSampleColumn(db, source, column, captureLayout)) {
+        close();
+        return false;
+    }
+    if (captureLayout.channels <= 0)
+        captureLayout.channels = kDefaultMBNChannels;
+    if (captureLayout.recordLength <= 0)
+        captureLayout.recordLength = kDefaultMBNRecordLength;
+    captureLayout.sampleCount = qint64(captureLayout.channels) * captureLayout.recordLength;
+
+    const QByteArray sql = QString("SELECT rowid, %1 FROM data WHERE rowid > ? ORDER BY rowid LIMIT ?")
+                               .arg(quotedIdentifier(captureLayout.column.toUtf8().constData()))
+                               .toUtf8();
+    if (sqlite3_prepare_v2(db, sql.constData(), -1, &stmt, nullptr) != SQLITE_OK) {
+        qWarning() << "Query failed in:" << source << sqlite3_errmsg(db);
+        close();
+        return false;
+    }
+
+    lastRowid = 0;
+    return true;
+}
+
+void DbTailReader::close()
+{
+    sqlite3_finalize(stmt);
+    stmt = nullptr;
+    sqlite3_close(db);
+    db = nullptr;
+}
+
+int DbTailReader::fetchNew(QVector<double> &out, int maxRows)
+{
+    out.clear();
+    if (!stmt)
+        return -1;
+
+    sqlite3_bind_int64(stmt, 1, lastRowid);
+    sqlite3_bind_int(stmt, 2, maxRows);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        lastRowid = sqlite3_column_int64(stmt, 0);
+        out.append(sqlite3_column_double(stmt, 1));
+    }
+    sqlite3_reset(stmt);
+
+    // A writer holding the lock just means "try again on the next poll"
+    if (rc != SQLITE_DONE && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+        qWarning() << "Read failed in:" << source << sqlite3_errmsg(db);
+        return -1;
+    }
+    return out.size();
+}
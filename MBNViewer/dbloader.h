@@ -1,9 +1,126 @@
-#pragma once
-#include <QList>
-#include <QVariant>
-
-using RowData = QList<QVariant>;
-using TableData = QList<RowData>;
-using DBTableData = QList<TableData>;
-
-DBTableData loadAllDbFiles(const QString &dirname);
+#pragma once
+#include <QList>
+#include <QVariant>
+#include <QVector>
+#include <QString>
+#include <functional>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+using RowData = QList<QVariant>;
+using TableData = QList<RowData>;
+using DBTableData = QList<TableData>;
+
+// Repeat count, record length and sample rate of the original rigs, used when a file
+// carries no layout metadata
+const int kDefaultMBNChannels = 5;
+const int kDefaultMBNRecordLength = 100000;
+const double kDefaultMBNSampleRate = 100000.0;
+
+// Shape of one capture, read from the schema before any sample is fetched:
+// `channels` blocks of `recordLength` samples each, stored channel-major.
+// The optional table mbn_meta(key, value) may set channels, record_length, fs and units;
+// whichever of channels/record_length is missing is derived from the row count
+// (channels falls back to kDefaultMBNChannels).
+struct CaptureLayout {
+    bool blob = false;       // channel-BLOB layout (mbn_channels) instead of table `data`
+    QString column;          // row layout: name of the sample column in `data`
+    qint64 sampleCount = 0;
+    int channels = 0;
+    int recordLength = 0;
+    double fs = 0.0;         // sample rate in Hz, 0 = not stored in the file
+    QString units;
+};
+
+// One numeric column of a .db file, read straight into contiguous memory
+struct RawColumn {
+    QString source;          // absolute path of the .db file
+    QVector<double> samples; // column values in rowid order, channel-major
+    int channels = 0;        // number of channel blocks
+    int recordLength = 0;    // samples per channel block
+    double fs = 0.0;         // sample rate in Hz, 0 = not stored in the file
+    QString units;
+};
+using DBColumnData = QList<RawColumn>;
+
+DBTableData loadAllDbFiles(const QString &dirname);
+
+bool discoverLayout(const QString &dbFile, CaptureLayout &layout, int column = 1);
+
+// Typed reader on the sqlite3 C API: only column `column` of table `data` is stepped,
+// values go through sqlite3_column_double into `out` without any QVariant boxing.
+// The file is opened read-only with immutable=1, so it must not be written concurrently.
+bool loadDbColumn(const QString &dbFile, QVector<double> &out, int column = 1);
+// Loads a single capture in place (read-only, immutable URI, bulk-read pragmas), no copy
+bool loadDbFile(const QString &dbFile, RawColumn &raw, int column = 1);
+DBColumnData loadAllDbColumns(const QString &dirPath, int column = 1);
+
+// Same as loadAllDbColumns, but files are read on a bounded thread pool (maxThreads <= 0:
+// one thread per core), one sqlite3 connection per worker. Output keeps the sorted file order.
+DBColumnData loadAllDbColumnsParallel(const QString &dirPath, int maxThreads = 0, int column = 1);
+
+// Streams the capture in chunks of at most chunkRows samples (file order, channel-major).
+// SQLite is stepped on a reader thread while `consume` runs on the calling thread, with at
+// most two chunks in flight. onLayout, if set, receives the discovered layout before the
+// first chunk. Either callback may return false to stop early (streamDbFile then returns
+// false as well).
+using ChunkConsumer = std::function<bool(const double *samples, int count)>;
+using LayoutConsumer = std::function<bool(const CaptureLayout &layout)>;
+bool streamDbFile(const QString &dbFile, const ChunkConsumer &consume,
+                  int chunkRows = 16384, int column = 1,
+                  const LayoutConsumer &onLayout = LayoutConsumer());
+
+// Channel-BLOB layout (table `mbn_channels`): one row per channel holding its samples as a
+// little-endian float64/float32 BLOB plus fs, channel index and units. The loaders above
+// detect it automatically and copy each BLOB straight into RawColumn::samples.
+struct BlobConvertOptions {
+    int column = 1;          // source column in the row-per-sample table `data`
+    int channels = 0;        // equal-length channel blocks, 0 = discovered layout
+    double fs = 0.0;         // 0 = discovered fs, else 100 kHz
+    QString units;           // empty = discovered units
+    bool float32 = false;    // store f32le instead of f64le
+};
+
+// The new database is written to "<dstFile>.part" and renamed over dstFile only once it is
+// committed, so a failed conversion leaves any existing dstFile alone. Converting a file
+// onto itself is refused (there is no in-place mode).
+bool convertDbToBlobLayout(const QString &srcFile, const QString &dstFile,
+                           const BlobConvertOptions &options = BlobConvertOptions());
+// Converts every *.db in srcDir into dstDir (same file names), returns the number converted;
+// dstDir must be a different directory
+int convertDirToBlobLayout(const QString &srcDir, const QString &dstDir,
+                           const BlobConvertOptions &options = BlobConvertOptions(),
+                           int maxThreads = 0);
+
+// Follows a capture that the acquisition software is still appending to. The file is
+// opened read-only without immutable=1, so each fetch sees newly committed rows (with the
+// writer in WAL mode, polling never blocks it). Only rows with a rowid above the last one
+// returned are read, so a poll costs time proportional to the new data.
+// Only the row-per-sample layout can be followed; the shape comes from mbn_meta or the
+// default 5 x 100000.
+class DbTailReader {
+public:
+    DbTailReader() = default;
+    ~DbTailReader();
+
+    bool open(const QString &dbFile, int column = 1);
+    void close();
+    bool isOpen() const { return stmt != nullptr; }
+
+    // Replaces out with the samples of rows added since the previous call (at most maxRows);
+    // returns their number, or -1 on error
+    int fetchNew(QVector<double> &out, int maxRows = 1 << 20);
+    qint64 lastRowId() const { return lastRowid; }
+    const CaptureLayout &layout() const { return captureLayout; }
+
+private:
+    QString source;
+    CaptureLayout captureLayout;
+    sqlite3 *db = nullptr;
+    sqlite3_stmt *stmt = nullptr;
+    qint64 lastRowid = 0;
+
+    DbTailReader(const DbTailReader &) = delete;
+    DbTailReader &operator=(const DbTailReader &) = delete;
+};
@@ -0,0 +1,73 @@
+#include "decimator.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+FIRDecimator::FIRDecimator(int factor)
+    : m(std::max(1, factor))
+{
+    if (factor < 1)
+        qWarning() << "Invalid decimation factor:" << factor;
+    if (m == 1) {
+        h = { 1.0 };
+        return;
+    }
+
+    // Windowed sinc, cut-off fs/(2m), normalised to unit DC gain
+    const int half = 10 * m;
+    h.resize(2 * half + 1);
+    double sum = 0.0;
+    for (int j = -half; j <= half; ++j) {
+        const double t = double(j) / m;
+        const double sinc = j == 0 ? 1.0 : std::sin(M_PI * t) / (M_PI * t);
+        const double window = 0.54 + 0.46 * std::cos(M_PI * j / half);
+        h[j + half] = sinc * window;
+        sum += h[j + half];
+    }
+    for (double &v : h)
+        v /= sum;
+}
+
+void FIRDecimator::decimate(const double *x, int n, double *out) const
+{
+    const int outN = outputLength(n);
+    if (m == 1) {
+        std::copy(x, x + n, out);
+        return;
+    }
+
+    const int half = h.size() / 2;
+    const double *c = h.constData() + half;   // c[-half .. half], symmetric
+    for (int k = 0; k < outN; ++k) {
+        const int centre = k * m;
+        if (centre - half >= 0 && centre + half < n) {
+            // Interior: fold the symmetric taps (one multiply per pair) and keep four
+            // independent partial sums so the adds overlap
+            const double *p = x + centre;
+            double s0 = c[0] * p[0], s1 = 0.0, s2 = 0.0, s3 = 0.0;
+            int j = 1;
+            for (; j + 3 <= half; j += 4) {
+                s0 += c[j]     * (p[-j]     + p[j]);
+                s1 += c[j + 1] * (p[-j - 1] + p[j + 1]);
+                s2 += c[j + 2] * (p[-j - 2] + p[j + 2]);
+                s3 += c[j + 3] * (p[-j - 3] + p[j + 3]);
+            }
+            for (; j <= half; ++j)
+                s0 += c[j] * (p[-j] + p[j]);
+            out[k] = (s0 + s1) + (s2 + s3);
+        } else {
+            // Within half taps of an end: clamp the indices
+            double s = 0.0;
+            for (int j = -half; j <= half; ++j)
+                s += c[j] * x[std::clamp(centre - j, 0, n - 1)];
+            out[k] = s;
+        }
+    }
+}
+
+QVector<double> FIRDecimator::decimate(const QVector<double> &x) const
+{
+    QVector<double> y(outputLength(x.size()));
+    decimate(x.constData(), x.size(), y.data());
+    return y;
+}
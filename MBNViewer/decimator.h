@@ -0,0 +1,26 @@
+#pragma once
+#include <QVector>
+
+// Anti-aliased decimation by an integer factor with a linear-phase FIR: a Hamming-windowed
+// sinc of 20*factor+1 taps with its cut-off at the output Nyquist frequency (the default
+// of scipy.signal.decimate). Only every factor-th output is computed (the polyphase form),
+// and the filter is centred on each kept sample, so output k lines up with input
+// k*factor and peaks are not delayed.
+class FIRDecimator {
+public:
+    FIRDecimator() = default;
+    explicit FIRDecimator(int factor);
+
+    int factor() const { return m; }
+    const QVector<double> &taps() const { return h; }
+    int outputLength(int n) const { return n <= 0 ? 0 : (n + m - 1) / m; }
+
+    // Writes outputLength(n) samples to out. Beyond either end of x the end sample is
+    // repeated, which keeps a slowly varying signal (such as a power envelope) level.
+    void decimate(const double *x, int n, double *out) const;
+    QVector<double> decimate(const QVector<double> &x) const;
+
+private:
+    int m = 1;
+    QVector<double> h;
+};
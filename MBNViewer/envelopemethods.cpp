@@ -0,0 +1,58 @@
+#include "envelopemethods.h"
+
+static MBNMatrix squareLaw(const MBNMatrix &mbnMatrix, const EnvelopeParams &params, double &envelopeFs)
+{
+    if (params.decimation > 1) {
+        EnvelopeMatrix envelopes = extractEnvelopesMultirate(mbnMatrix, params.fs, params.decimation,
+                                                             params.mode, params.cutoffHz);
+        envelopeFs = envelopes.fs;
+        return envelopes.samples;
+    }
+    envelopeFs = params.fs;
+    return extractEnvelopes(mbnMatrix, envelopeLowpass(2, params.cutoffHz, params.fs), params.mode);
+}
+
+static MBNMatrix hilbert(const MBNMatrix &mbnMatrix, const EnvelopeParams &params, double &envelopeFs)
+{
+    envelopeFs = params.fs;
+    return extractEnvelopesHilbert(mbnMatrix, params.fs, params.cutoffHz);
+}
+
+static MBNMatrix slidingRMS(const MBNMatrix &mbnMatrix, const EnvelopeParams &params, double &envelopeFs)
+{
+    envelopeFs = params.fs;
+    return extractEnvelopesRMS(mbnMatrix, params.fs, params.cutoffHz);
+}
+
+static MBNMatrix peakHold(const MBNMatrix &mbnMatrix, const EnvelopeParams &params, double &envelopeFs)
+{
+    envelopeFs = params.fs;
+    return extractEnvelopesPeakHold(mbnMatrix, params.fs, params.cutoffHz);
+}
+
+const QVector<EnvelopeMethod> &envelopeMethods()
+{
+    static const QVector<EnvelopeMethod> methods = {
+        { "square-law", "Square, 2nd-order Butterworth low-pass, square root", squareLaw },
+        { "hilbert", "Magnitude of the analytic signal (FFT), power smoothed at the cut-off", hilbert },
+        { "rms", "Centred sliding-window RMS", slidingRMS },
+        { "peak-hold", "Peak hold with exponential decay", peakHold },
+    };
+    return methods;
+}
+
+QStringList envelopeMethodNames()
+{
+    QStringList names;
+    for (const EnvelopeMethod &method : envelopeMethods())
+        names << QString::fromLatin1(method.name);
+    return names;
+}
+
+const EnvelopeMethod *findEnvelopeMethod(const QString &name)
+{
+    for (const EnvelopeMethod &method : envelopeMethods())
+        if (name == QLatin1String(method.name))
+            return &method;
+    return nullptr;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <QStringList>
+#include "signalprocessor.h"
+
+// Settings handed to every envelope method; each uses the ones that apply to it
+struct EnvelopeParams {
+    double fs = kDefaultMBNSampleRate;          // rate of the MBN signals
+    double cutoffHz = kEnvelopeCutoffHz;        // envelope bandwidth
+    EnvelopeMode mode = EnvelopeMode::Causal;   // square-law only
+    int decimation = 1;                         // square-law only (extractEnvelopesMultirate)
+};
+
+// One envelope detector of the registry. extract returns the envelopes of all signals
+// and stores their sample rate in envelopeFs (below params.fs when the method decimates).
+struct EnvelopeMethod {
+    const char *name;          // stable key used by the GUI, the pipeline options and the cache
+    const char *description;
+    MBNMatrix (*extract)(const MBNMatrix &mbnMatrix, const EnvelopeParams &params, double &envelopeFs);
+};
+
+// Registered methods in display order; the first one is the default
+const QVector<EnvelopeMethod> &envelopeMethods();
+QStringList envelopeMethodNames();
+// nullptr if no method has that name
+const EnvelopeMethod *findEnvelopeMethod(const QString &name);
@@ -0,0 +1,44 @@
+#include "fftplan.h"
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace {
+
+struct PlanCache {
+    QMutex mutex;
+    QHash<qint64, kiss_fft_cfg> plans;
+
+    ~PlanCache()
+    {
+        for (kiss_fft_cfg plan : plans)
+            kiss_fft_free(plan);
+    }
+};
+
+PlanCache &planCache()
+{
+    static PlanCache cache;
+    return cache;
+}
+
+} // namespace
+
+kiss_fft_cfg fftPlan(int nfft, bool inverse)
+{
+    if (nfft < 1)
+        return nullptr;
+
+    PlanCache &cache = planCache();
+    const qint64 key = qint64(nfft) * 2 + (inverse ? 1 : 0);
+    QMutexLocker lock(&cache.mutex);
+    kiss_fft_cfg &plan = cache.plans[key];
+    if (!plan)
+        plan = kiss_fft_alloc(nfft, inverse ? 1 : 0, nullptr, nullptr);
+    return plan;
+}
+
+int fftFastSize(int n)
+{
+    return kiss_fft_next_fast_size(n < 1 ? 1 : n);
+}
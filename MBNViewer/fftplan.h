@@ -0,0 +1,12 @@
+#pragma once
+#include "kiss_fft.h"
+
+// Shared kiss_fft plans. A plan (twiddles and factorisation) is built the first time a
+// size/direction is asked for and then kept for the rest of the run, so repeated
+// transforms of the same length skip kiss_fft_alloc. Transforms only read the plan, so
+// one plan may be used from several threads at once. Never free the returned plan.
+kiss_fft_cfg fftPlan(int nfft, bool inverse);
+
+// Smallest n' >= n whose only prime factors are 2, 3 and 5; kiss_fft runs those sizes
+// with its specialised butterflies, usually with less padding than the next power of two
+int fftFastSize(int n);
@@ -0,0 +1,420 @@
+#include "iirfilter.h"
+#include "simdkernels.h"
+#include <QDebug>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+using Complex = std::complex<double>;
+
+// Samples per lane interleaved at a time by applyBatch: 512 x 8 doubles = 32 KB, which
+// stays in L1/L2 while every section runs over it
+static const int kBatchBlock = 512;
+
+namespace {
+
+// Zeros, poles and gain of an analog or digital filter
+struct Zpk {
+    QVector<Complex> z;
+    QVector<Complex> p;
+    double k = 1.0;
+};
+
+Complex product(const QVector<Complex> &v, Complex offset, double sign)
+{
+    Complex r(1.0, 0.0);
+    for (const Complex &x : v)
+        r *= offset + sign * x;
+    return r;
+}
+
+Zpk butterworthPrototype(int order)
+{
+    Zpk a;
+    for (int m = -order + 1; m < order; m += 2)
+        a.p.append(-std::exp(Complex(0.0, M_PI * m / (2.0 * order))));
+    return a;
+}
+
+Zpk chebyshev1Prototype(int order, double rippleDb)
+{
+    Zpk a;
+    const double eps = std::sqrt(std::pow(10.0, 0.1 * rippleDb) - 1.0);
+    const double mu = std::asinh(1.0 / eps) / order;
+    for (int m = -order + 1; m < order; m += 2)
+        a.p.append(-std::sinh(Complex(mu, M_PI * m / (2.0 * order))));
+    a.k = product(a.p, 0.0, -1.0).real();
+    if (order % 2 == 0)
+        a.k /= std::sqrt(1.0 + eps * eps);
+    return a;
+}
+
+// Low-pass prototype (cut-off 1 rad/s) -> analog low/high/band-pass at the warped edges
+Zpk transformPrototype(const Zpk &a, FilterType type, double w1, double w2)
+{
+    Zpk r;
+    const int degree = a.p.size() - a.z.size();
+    switch (type) {
+    case FilterType::LowPass:
+        for (const Complex &z : a.z) r.z.append(z * w1);
+        for (const Complex &p : a.p) r.p.append(p * w1);
+        r.k = a.k * std::pow(w1, degree);
+        break;
+    case FilterType::HighPass:
+        for (const Complex &z : a.z) r.z.append(w1 / z);
+        for (const Complex &p : a.p) r.p.append(w1 / p);
+        r.z.append(QVector<Complex>(degree, Complex(0.0, 0.0)));
+        r.k = a.k * (product(a.z, 0.0, -1.0) / product(a.p, 0.0, -1.0)).real();
+        break;
+    case FilterType::BandPass: {
+        const double bw = w2 - w1;
+        const double wo = std::sqrt(w1 * w2);
+        auto split = [&](const QVector<Complex> &in, QVector<Complex> &out) {
+            for (const Complex &x : in) {
+                const Complex lp = x * (bw / 2.0);
+                const Complex d = std::sqrt(lp * lp - wo * wo);
+                out.append(lp + d);
+                out.append(lp - d);
+            }
+        };
+        split(a.z, r.z);
+        split(a.p, r.p);
+        r.z.append(QVector<Complex>(degree, Complex(0.0, 0.0)));
+        r.k = a.k * std::pow(bw, degree);
+        break;
+    }
+    }
+    return r;
+}
+
+// Analog -> digital; zeros at infinity land on z = -1
+Zpk bilinear(const Zpk &a, double fs)
+{
+    const double fs2 = 2.0 * fs;
+    Zpk d;
+    for (const Complex &z : a.z) d.z.append((fs2 + z) / (fs2 - z));
+    for (const Complex &p : a.p) d.p.append((fs2 + p) / (fs2 - p));
+    d.z.append(QVector<Complex>(a.p.size() - a.z.size(), Complex(-1.0, 0.0)));
+    d.k = a.k * (product(a.z, fs2, -1.0) / product(a.p, fs2, -1.0)).real();
+    return d;
+}
+
+// Roots grouped into the (at most two) roots of each section. Complex roots go with their
+// conjugate, real roots are paired up; an odd real root is returned alone, first.
+QVector<QVector<Complex>> groupRoots(const QVector<Complex> &roots, bool outerPairs)
+{
+    QVector<QVector<Complex>> groups;
+    QVector<double> reals;
+    for (const Complex &r : roots) {
+        const double tol = 1e-10 * std::max(1.0, std::abs(r));
+        if (r.imag() > tol)
+            groups.append(QVector<Complex>{ r, std::conj(r) });
+        else if (r.imag() >= -tol)
+            reals.append(r.real());
+    }
+
+    // Poles closest to the unit circle go last, where they see the least amplified signal
+    std::sort(groups.begin(), groups.end(), [](const QVector<Complex> &a, const QVector<Complex> &b) {
+        return std::abs(a[0]) < std::abs(b[0]);
+    });
+    std::sort(reals.begin(), reals.end());
+
+    QVector<QVector<Complex>> realGroups;
+    int lo = 0, hi = reals.size() - 1;
+    if (reals.size() % 2 != 0) {
+        // Odd count: the middle (zeros) or largest (poles) real root is left single
+        const int single = outerPairs ? reals.size() / 2 : hi;
+        realGroups.append(QVector<Complex>{ Complex(reals[single], 0.0) });
+        reals.remove(single);
+        hi = reals.size() - 1;
+    }
+    while (lo < hi) {
+        if (outerPairs)
+            realGroups.append(QVector<Complex>{ Complex(reals[lo++], 0.0), Complex(reals[hi--], 0.0) });
+        else {
+            realGroups.append(QVector<Complex>{ Complex(reals[lo], 0.0), Complex(reals[lo + 1], 0.0) });
+            lo += 2;
+        }
+    }
+    return realGroups + groups;
+}
+
+// sum and product of the (one or two) roots -> the z^-1, z^-2 coefficients
+void rootsToCoefficients(const QVector<Complex> &roots, double &c1, double &c2)
+{
+    if (roots.size() == 1) {
+        c1 = -roots[0].real();
+        c2 = 0.0;
+    } else {
+        c1 = -(roots[0] + roots[1]).real();
+        c2 = (roots[0] * roots[1]).real();
+    }
+}
+
+QVector<Biquad> zpkToSections(const Zpk &d)
+{
+    // Zeros are paired outermost-first so that a band-pass gets one +1 and one -1 zero
+    // per section instead of two equal ones
+    const QVector<QVector<Complex>> poles = groupRoots(d.p, false);
+    const QVector<QVector<Complex>> zeros = groupRoots(d.z, true);
+
+    QVector<Biquad> sos(poles.size());
+    for (int i = 0; i < sos.size(); ++i) {
+        Biquad &s = sos[i];
+        rootsToCoefficients(poles[i], s.a1, s.a2);
+        if (i < zeros.size())
+            rootsToCoefficients(zeros[i], s.b1, s.b2);
+    }
+    // The overall gain is folded into the first section
+    if (!sos.isEmpty()) {
+        sos[0].b0 *= d.k;
+        sos[0].b1 *= d.k;
+        sos[0].b2 *= d.k;
+    }
+    return sos;
+}
+
+IIRFilter design(const Zpk &prototype, int order, FilterType type, double fs, double f1, double f2)
+{
+    const double nyquist = fs / 2.0;
+    const bool bandOk = type != FilterType::BandPass || (f2 > f1 && f2 < nyquist);
+    if (order < 1 || order > 64 || fs <= 0.0 || f1 <= 0.0 || f1 >= nyquist || !bandOk) {
+        qWarning() << "Invalid filter design: order" << order << "fs" << fs << "edges" << f1 << f2;
+        return IIRFilter();
+    }
+
+    // Pre-warp the edges so that the bilinear transform puts them at f1/f2 exactly
+    const double w1 = 2.0 * fs * std::tan(M_PI * f1 / fs);
+    const double w2 = type == FilterType::BandPass ? 2.0 * fs * std::tan(M_PI * f2 / fs) : 0.0;
+    return IIRFilter(zpkToSections(bilinear(transformPrototype(prototype, type, w1, w2), fs)));
+}
+
+} // namespace
+
+IIRFilter::IIRFilter(const QVector<Biquad> &sections)
+    : sos(sections)
+{
+}
+
+IIRFilter IIRFilter::butterworth(int order, FilterType type, double fs, double f1, double f2)
+{
+    return design(butterworthPrototype(std::clamp(order, 1, 64)), order, type, fs, f1, f2);
+}
+
+IIRFilter IIRFilter::chebyshev1(int order, double rippleDb, FilterType type, double fs,
+                                double f1, double f2)
+{
+    if (!(rippleDb > 0.0)) {
+        qWarning() << "Invalid filter design: ripple" << rippleDb << "dB";
+        return IIRFilter();
+    }
+    return design(chebyshev1Prototype(std::clamp(order, 1, 64), rippleDb), order, type, fs, f1, f2);
+}
+
+void IIRFilter::apply(const double *in, double *out, int n) const
+{
+    QVarLengthArray<double, 32> state(stateSize());
+    std::fill(state.begin(), state.end(), 0.0);
+    filter(in, out, n, state.data());
+}
+
+QVector<double> IIRFilter::apply(const QVector<double> &x) const
+{
+    QVector<double> y(x.size());
+    apply(x.constData(), y.data(), x.size());
+    return y;
+}
+
+// One pass over the block per section: the five coefficients and the two state values
+// stay in registers and the loop body has no branches. Reverse walks the block from its
+// last sample to its first.
+template <bool Reverse>
+static void runCascade(const QVector<Biquad> &sos, const double *in, double *out, int n,
+                       double *state)
+{
+    if (sos.isEmpty()) {
+        if (out != in)
+            std::copy(in, in + n, out);
+        return;
+    }
+
+    const double *src = in;
+    for (int s = 0; s < sos.size(); ++s) {
+        const double b0 = sos[s].b0, b1 = sos[s].b1, b2 = sos[s].b2;
+        const double a1 = sos[s].a1, a2 = sos[s].a2;
+        double s1 = state[2 * s];
+        double s2 = state[2 * s + 1];
+        for (int j = 0; j < n; ++j) {
+            const int i = Reverse ? n - 1 - j : j;
+            const double x = src[i];
+            const double y = b0 * x + s1;
+            s1 = b1 * x - a1 * y + s2;
+            s2 = b2 * x - a2 * y;
+            out[i] = y;
+        }
+        state[2 * s] = s1;
+        state[2 * s + 1] = s2;
+        src = out;
+    }
+}
+
+void IIRFilter::filter(const double *in, double *out, int n, double *state) const
+{
+    runCascade<false>(sos, in, out, n, state);
+}
+
+void IIRFilter::filterReverse(const double *in, double *out, int n, double *state) const
+{
+    runCascade<true>(sos, in, out, n, state);
+}
+
+void IIRFilter::steadyState(double x, double *state) const
+{
+    // At steady state each section outputs its DC gain times its input, which is in
+    // turn the output of the previous section
+    for (int s = 0; s < sos.size(); ++s) {
+        const Biquad &q = sos[s];
+        const double y = x * (q.b0 + q.b1 + q.b2) / (1.0 + q.a1 + q.a2);
+        state[2 * s + 1] = q.b2 * x - q.a2 * y;
+        state[2 * s] = y - q.b0 * x;
+        x = y;
+    }
+}
+
+int IIRFilter::zeroPhasePadding() const
+{
+    // scipy.signal.sosfiltfilt's default: three times the number of filter taps, not
+    // counting the taps of first-order sections
+    int b2Zero = 0, a2Zero = 0;
+    for (const Biquad &q : sos) {
+        b2Zero += q.b2 == 0.0;
+        a2Zero += q.a2 == 0.0;
+    }
+    return 3 * (2 * sos.size() + 1 - std::min(b2Zero, a2Zero));
+}
+
+void IIRFilter::applyZeroPhase(double *x, int n) const
+{
+    if (sos.isEmpty() || n <= 0)
+        return;
+
+    // The odd extensions 2*x[0] - x[pad..1] and 2*x[n-1] - x[n-2..n-1-pad] are never
+    // materialised around the signal: only the pad samples themselves are buffered, so
+    // the signal is filtered in place in both directions
+    const int pad = std::min(zeroPhasePadding(), n - 1);
+    QVarLengthArray<double, 64> head(pad), tail(pad), state(stateSize());
+    for (int i = 0; i < pad; ++i) {
+        head[i] = 2.0 * x[0] - x[pad - i];
+        tail[i] = 2.0 * x[n - 1] - x[n - 2 - i];
+    }
+
+    // Forward over head, signal, tail, starting in steady state at the first sample
+    steadyState(pad > 0 ? head[0] : x[0], state.data());
+    filter(head.constData(), head.data(), pad, state.data());
+    filter(x, x, n, state.data());
+    filter(tail.constData(), tail.data(), pad, state.data());
+
+    // Backward from the end of the forward output; the head is not needed again
+    steadyState(pad > 0 ? tail[pad - 1] : x[n - 1], state.data());
+    filterReverse(tail.constData(), tail.data(), pad, state.data());
+    filterReverse(x, x, n, state.data());
+}
+
+QVector<double> IIRFilter::applyZeroPhase(const QVector<double> &x) const
+{
+    QVector<double> y = x;
+    applyZeroPhase(y.data(), y.size());
+    return y;
+}
+
+QVector<double> IIRFilter::packedCoefficients() const
+{
+    QVector<double> coeffs;
+    coeffs.reserve(5 * sos.size());
+    for (const Biquad &s : sos)
+        coeffs << s.b0 << s.b1 << s.b2 << s.a1 << s.a2;
+    return coeffs;
+}
+
+void IIRFilter::applyBatch(QVector<QVector<double>> &batch) const
+{
+    if (sos.isEmpty())
+        return;
+
+    const QVector<double> coeffs = packedCoefficients();
+
+    QVector<double> tile(kBatchBlock * kBiquadLanes);
+    QVector<double> state(2 * kBiquadLanes * sos.size());
+    double *lanes[kBiquadLanes];
+
+    for (int first = 0; first < batch.size();) {
+        // Next run of up to kBiquadLanes signals of the same length
+        const int n = batch[first].size();
+        int count = 1;
+        while (count < kBiquadLanes && first + count < batch.size()
+               && batch[first + count].size() == n)
+            ++count;
+
+        if (count == 1) {
+            apply(batch[first].constData(), batch[first].data(), n);
+            ++first;
+            continue;
+        }
+
+        // Unused lanes filter zeros and are never copied back
+        for (int l = 0; l < count; ++l)
+            lanes[l] = batch[first + l].data();
+        tile.fill(0.0);
+        state.fill(0.0);
+
+        // Row i of the tile is one full cache line, written (and read back) in one go
+        double *t = tile.data();
+        for (int begin = 0; begin < n; begin += kBatchBlock) {
+            const int len = std::min(kBatchBlock, n - begin);
+            for (int i = 0; i < len; ++i) {
+                double *row = t + i * kBiquadLanes;
+                for (int l = 0; l < count; ++l)
+                    row[l] = lanes[l][begin + i];
+            }
+
+            biquadCascadeLanes(coeffs.constData(), sos.size(), t, len, state.data());
+
+            for (int i = 0; i < len; ++i) {
+                const double *row = t + i * kBiquadLanes;
+                for (int l = 0; l < count; ++l)
+                    lanes[l][begin + i] = row[l];
+            }
+        }
+        first += count;
+    }
+}
+
+StreamingIIRFilter::StreamingIIRFilter(const IIRFilter &filter)
+    : iir(filter)
+{
+    reset();
+}
+
+void StreamingIIRFilter::reset()
+{
+    state.fill(0.0, iir.stateSize());
+}
+
+void StreamingIIRFilter::resetSteadyState(double x)
+{
+    state.resize(iir.stateSize());
+    iir.steadyState(x, state.data());
+}
+
+void StreamingIIRFilter::process(const double *in, double *out, int n)
+{
+    iir.filter(in, out, n, state.data());
+}
+
+QVector<double> StreamingIIRFilter::process(const QVector<double> &chunk)
+{
+    QVector<double> y(chunk.size());
+    process(chunk.constData(), y.data(), chunk.size());
+    return y;
+}
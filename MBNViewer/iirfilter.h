@@ -0,0 +1,91 @@
+#pragma once
+#include <QVector>
+
+// One second-order section, normalised so that a0 = 1:
+//   H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)
+struct Biquad {
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0;
+    double a1 = 0.0, a2 = 0.0;
+};
+
+enum class FilterType {
+    LowPass,
+    HighPass,
+    BandPass
+};
+
+// Digital IIR filter stored as a cascade of second-order sections. The design (analog
+// prototype -> frequency transform -> bilinear transform with pre-warping, as in
+// scipy.signal) is done once by the factories; filtering only runs the cascade.
+// A filter that failed to design has no sections and passes its input through.
+class IIRFilter {
+public:
+    IIRFilter() = default;
+    explicit IIRFilter(const QVector<Biquad> &sections);
+
+    // Cut-offs in Hz; f2 is the upper edge of a band-pass and ignored otherwise.
+    // Order is that of the low-pass prototype (a band-pass has twice as many poles).
+    static IIRFilter butterworth(int order, FilterType type, double fs, double f1, double f2 = 0.0);
+    // Type I Chebyshev with rippleDb of pass-band ripple
+    static IIRFilter chebyshev1(int order, double rippleDb, FilterType type, double fs,
+                                double f1, double f2 = 0.0);
+
+    bool isValid() const { return !sos.isEmpty(); }
+    const QVector<Biquad> &sections() const { return sos; }
+    // Doubles of filter state needed by filter(): two per section
+    int stateSize() const { return 2 * sos.size(); }
+    // {b0, b1, b2, a1, a2} of every section, the layout biquadCascadeLanes takes
+    QVector<double> packedCoefficients() const;
+
+    // Runs the cascade from rest; in and out may be the same buffer
+    void apply(const double *in, double *out, int n) const;
+    QVector<double> apply(const QVector<double> &x) const;
+
+    // Filters every signal in place, from rest. Runs of equal-length signals are
+    // interleaved kBiquadLanes at a time and filtered together in SIMD lanes (see
+    // simdkernels.h); each result is bit-identical to apply() on that signal alone.
+    void applyBatch(QVector<QVector<double>> &batch) const;
+
+    // Same, continuing from (and updating) the transposed direct-form II state in
+    // state[0 .. stateSize()). Splitting a signal into blocks gives the same output.
+    void filter(const double *in, double *out, int n, double *state) const;
+    // Same, running through the block from in[n-1] down to in[0]
+    void filterReverse(const double *in, double *out, int n, double *state) const;
+    // Fills state with the delays reached after a constant input x
+    void steadyState(double x, double *state) const;
+
+    // Zero-phase forward-backward filtering, as scipy.signal.sosfiltfilt: odd extension of
+    // zeroPhasePadding() samples at both ends (fewer for short signals) and steady-state
+    // initial conditions in each direction. Runs in place; only the padding is buffered.
+    // The magnitude response is squared and the group delay is zero.
+    void applyZeroPhase(double *x, int n) const;
+    QVector<double> applyZeroPhase(const QVector<double> &x) const;
+    int zeroPhasePadding() const;
+
+private:
+    QVector<Biquad> sos;
+};
+
+// An IIRFilter together with its delay line, for signals that arrive in chunks. Feeding
+// a signal chunk by chunk gives exactly the output of one call over the whole signal.
+class StreamingIIRFilter {
+public:
+    StreamingIIRFilter() = default;
+    explicit StreamingIIRFilter(const IIRFilter &filter);
+
+    const IIRFilter &filter() const { return iir; }
+
+    // Back to rest (all delays zero), as at the start of IIRFilter::apply
+    void reset();
+    // Delays of a filter that has seen the constant input x forever, so that a signal
+    // starting at x produces no start-up transient (scipy's lfilter_zi / sosfilt_zi * x)
+    void resetSteadyState(double x);
+
+    // in and out may be the same buffer
+    void process(const double *in, double *out, int n);
+    QVector<double> process(const QVector<double> &chunk);
+
+private:
+    IIRFilter iir;
+    QVector<double> state;
+};
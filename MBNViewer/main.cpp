@@ -1,10 +1,18 @@
-#include "mainwindow.h"
-#include <QApplication>
-
-int main(int argc, char *argv[])
-{
-    QApplication a(argc, argv);
-    MainWindow w;
-    w.show();
-    return a.exec();
-}
+#include "mainwindow.h"
+#include "benchmarks.h"
+#include <QApplication>
+#include <QCoreApplication>
+
+int main(int argc, char *argv[])
+{
+    // Headless micro-benchmarks: MBNViewer --bench [name ...] [capture.db ...]
+    if (argc > 1 && qstrcmp(argv[1], "--bench") == 0) {
+        QCoreApplication a(argc, argv);
+        return runBenchmarks(a.arguments().mid(2));
+    }
+
+    QApplication a(argc, argv);
+    MainWindow w;
+    w.show();
+    return a.exec();
+}
@@ -1,258 +1,534 @@
-#include "mainwindow.h"
-#include "ui_mainwindow.h"
-#include <QFileDialog>
-#include <QtCharts/QChartView>
-#include <QtCharts/QLineSeries>
-#include <QtCharts/QChart>
-#include <QtGlobal>
-#include <kiss_fft.h>      // Make sure to add INCLUDEPATH and LIBS in .pro
-#include <QTemporaryDir>  // For creating temporary directory
-
-
-MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), ui(new Ui::MainWindow())
-{
-    ui->setupUi(this);
-}
-
-MainWindow::~MainWindow()
-{
-    delete ui;
-}
-
-void MainWindow::analyzeSignalFeatures(int index)
-{
-    if (index < 0 || index >= mbnMatrix.size()) return;
-    const DoubleVector &mbn = mbnMatrix[index];
-    int N = mbn.size();
-    if (N == 0) return;
-
-    // 1. Mean & RMS
-    double sumAbs = 0.0, sumSq = 0.0;
-    for (double v : mbn) {
-        sumAbs += std::abs(v);
-        sumSq  += v * v;
-    }
-    double meanVal = sumAbs / N;
-    double rmsVal  = std::sqrt(sumSq / N);
-
-    // 2. Ringing count: convert to QList<double>
-    QList<double> mbnList = mbn.toList();
-    int ringCount = countRingingByPeaks(mbnList, 0.02);
-
-    // 3. Output Mean/RMS/Ringing count
-    log(QString("=== Signal %1 Features ===").arg(index + 1));
-    log(QString("Mean_Value[%1] = %2").arg(index).arg(meanVal, 0, 'f', 15));
-    log(QString("RMS_Value[%1]  = %2").arg(index).arg(rmsVal,  0, 'f', 7));
-    log(QString("Number of ringing = %1").arg(ringCount));
-
-    // 4. Envelope peak features (FWHM, ratio, etc.)
-    if (index < envelopeMatrix.size()) {
-        QList<double> envList = envelopeMatrix[index].toList();
-        auto peaks = findPeaksWithWidth(envList, 100000.0, 0.2);
-        for (int j = 0; j < peaks.size(); ++j) {
-            const auto &p = peaks[j];
-            log(QString("Peak %1: amplitude=%2, FWHM=%3 s, ratio=%4")
-                    .arg(j + 1)
-                    .arg(p.amplitude, 0, 'f', 3)
-                    .arg(p.fwhm,      0, 'f', 6)
-                    .arg(p.ratio,     0, 'f', 3));
-        }
-    }
-}
-
-void MainWindow::log(const QString &s)
-{
-    ui->textLog->append(s);
-}
-
-void MainWindow::on_btnBrowse_clicked()
-{
-    // Only support selecting a single .db file
-    QString file = QFileDialog::getOpenFileName(this, "Select a single .db file", QString(), "SQLite DB (*.db)");
-    if (file.isEmpty()) return;
-    ui->editDir->setText(file);
-}
-
-void MainWindow::on_btnLoad_clicked()
-{
-    QString path = ui->editDir->text();
-    if (path.isEmpty()) {
-        log("File path is empty");
-        return;
-    }
-
-    QFileInfo fi(path);
-    if (!fi.exists() || !fi.isFile()) {
-        log("Specified path is not a valid file");
-        return;
-    }
-
-    // Copy to temporary directory, then use loadAllDbFiles(directory)
-    QTemporaryDir tmpDir;
-    if (!tmpDir.isValid()) {
-        log("Failed to create temporary directory");
-        return;
-    }
-
-    const QString dstPath = tmpDir.path() + QLatin1Char('/') + fi.fileName();
-    if (QFile::exists(dstPath)) QFile::remove(dstPath);
-    if (!QFile::copy(path, dstPath)) {
-        log(QString("Failed to copy file to temporary directory: %1").arg(path));
-        return;
-    }
-
-    // Now only this .db file exists in the temporary dir
-    auto allData = loadAllDbFiles(tmpDir.path());
-    log(QString("Actually loaded %1 .db file(s)").arg(allData.size()));
-    if (allData.isEmpty()) {
-        log("No data loaded: file cannot be opened or contains no data");
-        return;
-    }
-
-    mbnMatrix      = processAllMBN(allData);
-    envelopeMatrix = extractEnvelopes(mbnMatrix);
-    log(QString("Processed %1 valid MBN signals").arg(mbnMatrix.size()));
-
-    if (!mbnMatrix.isEmpty()) {
-        currentIndex = 0;
-        plotTimeDomain(currentIndex);
-        analyzeSignalFeatures(currentIndex);
-    }
-}
-
-void MainWindow::on_btnPlotTime_clicked()
-{
-    if (mbnMatrix.isEmpty()) {
-        log("No data detected");
-        return;
-    }
-    plotTimeDomain(currentIndex);
-    analyzeSignalFeatures(currentIndex);
-}
-
-void MainWindow::on_btnPlotFreq_clicked()
-{
-    if (mbnMatrix.isEmpty()) {
-        log("No data detected");
-        return;
-    }
-    plotFrequencySpectrum(currentIndex);
-}
-
-void MainWindow::on_btnPlotEnv_clicked()
-{
-    if (envelopeMatrix.isEmpty()) {
-        log("No data detected");
-        return;
-    }
-    plotEnvelope(currentIndex);
-    analyzeSignalFeatures(currentIndex);
-}
-
-void MainWindow::plotTimeDomain(int /*index*/)
-{
-    QChart *chart = new QChart();
-
-    for (const DoubleVector &mbn : mbnMatrix) {
-        QLineSeries *series = new QLineSeries();
-        for (int i = 0; i < mbn.size(); ++i) {
-            series->append(i, mbn[i]);
-        }
-        chart->addSeries(series);
-    }
-
-    chart->createDefaultAxes();
-    chart->setTitle("MBN Curves");
-
-    chart->axisX()->setTitleText("Time (sample index)");
-    chart->axisY()->setTitleText("MBN Amplitude");
-
-    ui->widget->setChart(chart);
-}
-
-void MainWindow::plotFrequencySpectrum(int index)
-{
-    if (index < 0 || index >= mbnMatrix.size())
-        return;
-
-    QChart *chart = new QChart();
-    chart->setTitle("Frequency Spectrum");
-
-    const int fs = 100000; // Sampling rate
-    const DoubleVector &mbn = mbnMatrix[index];
-    int N = mbn.size();
-    if (N == 0) {
-        ui->widget->setChart(chart);
-        return;
-    }
-
-    int Nfft = 1 << static_cast<int>(std::ceil(std::log2(N)));
-
-    kiss_fft_cfg cfg = kiss_fft_alloc(Nfft, 0, nullptr, nullptr);
-    std::vector<kiss_fft_cpx> in(Nfft), out(Nfft);
-
-    for (int i = 0; i < N; ++i) {
-        in[i].r = mbn[i];
-        in[i].i = 0;
-    }
-    for (int i = N; i < Nfft; ++i) {
-        in[i].r = in[i].i = 0;
-    }
-
-    kiss_fft(cfg, in.data(), out.data());
-    kiss_fft_free(cfg);
-
-    int M = Nfft/2 + 1;
-    QVector<double> P1(M), freq(M);
-    for (int i = 0; i < M; ++i) {
-        double mag = std::hypot(out[i].r, out[i].i) / Nfft;
-        if (i != 0 && i != Nfft/2)
-            mag *= 2.0;
-        P1[i]   = mag;
-        freq[i] = double(fs) * i / Nfft;
-    }
-
-    QLineSeries *series = new QLineSeries();
-    for (int i = 0; i < M; ++i) {
-        series->append(freq[i], P1[i]);
-    }
-    chart->addSeries(series);
-
-    chart->createDefaultAxes();
-    chart->axisX()->setTitleText("Frequency (Hz)");
-    chart->axisY()->setTitleText("Amplitude");
-    ui->widget->setChart(chart);
-    ui->widget->setRenderHint(QPainter::Antialiasing);
-}
-
-void MainWindow::plotEnvelope(int /*index*/)
-{
-    QChart *chart = new QChart();
-    chart->setTitle("Signals & Envelopes");
-
-    for (int i = 0; i < mbnMatrix.size(); ++i) {
-        QLineSeries *sRaw = new QLineSeries();
-        QLineSeries *sEnv = new QLineSeries();
-        sRaw->setName(QString("MBN Raw %1").arg(i + 1));
-        sEnv->setName(QString("Envelope %1").arg(i + 1));
-
-        const DoubleVector &raw = mbnMatrix[i];
-        const DoubleVector &env = envelopeMatrix[i];
-        for (int j = 0; j < raw.size(); ++j) {
-            sRaw->append(j, raw[j]);
-            sEnv->append(j, env[j]);
-        }
-
-        chart->addSeries(sRaw);
-        chart->addSeries(sEnv);
-    }
-
-    chart->createDefaultAxes();
-
-    chart->axisX()->setTitleText("Time (sample index)");
-    chart->axisY()->setTitleText("Amplitude");
-
-    ui->widget->setChart(chart);
-    ui->widget->setRenderHint(QPainter::Antialiasing);
-}
+#include "mainwindow.h"
+#include "ui_mainwindow.h"
+#include <QtConcurrent>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QtCharts/QChartView>
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QChart>
+#include <QtCharts/QValueAxis>
+#include <QtGlobal>
+#include <kiss_fft.h>      // Make sure to add INCLUDEPATH and LIBS in .pro
+#include "fftplan.h"
+
+// History kept by the live peak detector; longer peaks are not reported while following
+static const double kLivePeakLookbackSec = 1.0;
+// The provisional part of the live curve is drawn as min/max pairs of at most this many
+// buckets, since it is replaced on every tick
+static const int kMaxProvisionalBuckets = 2000;
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent), ui(new Ui::MainWindow())
+{
+    ui->setupUi(this);
+    ui->btnCancel->setEnabled(false);
+    for (const EnvelopeMethod &method : envelopeMethods()) {
+        ui->comboEnvelope->addItem(QString::fromLatin1(method.name));
+        ui->comboEnvelope->setItemData(ui->comboEnvelope->count() - 1,
+                                       QString::fromLatin1(method.description), Qt::ToolTipRole);
+    }
+
+    // QFutureWatcher lives in the GUI thread, so its signals arrive here queued
+    connect(&loadWatcher, &QFutureWatcher<PipelineResult>::progressTextChanged,
+            this, [this](const QString &text) { ui->statusbar->showMessage(text); });
+    connect(&loadWatcher, &QFutureWatcher<PipelineResult>::progressValueChanged,
+            this, [this](int value) {
+                ui->statusbar->showMessage(QString("%1 (%2%)").arg(loadWatcher.progressText()).arg(value));
+            });
+    connect(&loadWatcher, &QFutureWatcher<PipelineResult>::finished,
+            this, &MainWindow::onLoadFinished);
+
+    followTimer.setInterval(500);
+    connect(&followTimer, &QTimer::timeout, this, &MainWindow::onFollowTick);
+}
+
+MainWindow::~MainWindow()
+{
+    // Do not leave the worker writing into a destroyed window
+    loadWatcher.cancel();
+    loadWatcher.waitForFinished();
+    followTimer.stop();
+    delete ui;
+}
+
+void MainWindow::analyzeSignalFeatures(int index)
+{
+    if (index < 0 || index >= signalFeatures.size()) return;
+    const SignalFeatures &f = signalFeatures[index];
+
+    // Output Mean/RMS/Ringing count
+    log(QString("=== Signal %1 Features ===").arg(index + 1));
+    log(QString("Mean_Value[%1] = %2").arg(index).arg(f.meanAbs, 0, 'f', 15));
+    log(QString("RMS_Value[%1]  = %2").arg(index).arg(f.rms,     0, 'f', 7));
+    log(QString("Number of ringing = %1").arg(f.ringing));
+
+    // Envelope peak features (FWHM, ratio, etc.)
+    for (int j = 0; j < f.peaks.size(); ++j) {
+        const auto &p = f.peaks[j];
+        log(QString("Peak %1: amplitude=%2, FWHM=%3 s, ratio=%4")
+                .arg(j + 1)
+                .arg(p.amplitude, 0, 'f', 3)
+                .arg(p.fwhm,      0, 'f', 6)
+                .arg(p.ratio,     0, 'f', 3));
+    }
+}
+
+void MainWindow::log(const QString &s)
+{
+    ui->textLog->append(s);
+}
+
+void MainWindow::on_btnBrowse_clicked()
+{
+    // Only support selecting a single .db file
+    QString file = QFileDialog::getOpenFileName(this, "Select a single .db file", QString(), "SQLite DB (*.db)");
+    if (file.isEmpty()) return;
+    ui->editDir->setText(file);
+}
+
+void MainWindow::on_btnLoad_clicked()
+{
+    QString path = ui->editDir->text();
+    if (path.isEmpty()) {
+        log("File path is empty");
+        return;
+    }
+
+    QFileInfo fi(path);
+    if (!fi.exists() || !fi.isFile()) {
+        log("Specified path is not a valid file");
+        return;
+    }
+
+    if (loadWatcher.isRunning()) {
+        log("A file is still loading");
+        return;
+    }
+
+    if (followTimer.isActive()) {
+        log("Stop following before loading a file");
+        return;
+    }
+
+    // Load and process on a worker thread; results come back through onLoadFinished
+    ui->btnLoad->setEnabled(false);
+    ui->btnCancel->setEnabled(true);
+    loadWatcher.setFuture(QtConcurrent::run(runLoadPipeline, path, pipelineOptions()));
+}
+
+PipelineOptions MainWindow::pipelineOptions() const
+{
+    PipelineOptions options;
+    options.envelopeMethod = ui->comboEnvelope->currentText();
+    options.envelopeMode = ui->chkZeroPhase->isChecked() ? EnvelopeMode::ZeroPhase
+                                                         : EnvelopeMode::Causal;
+    options.envelopeDecimation = ui->spinDecimation->value();
+    options.maxPeaks = ui->spinTopPeaks->value();
+    return options;
+}
+
+void MainWindow::on_btnCancel_clicked()
+{
+    if (!loadWatcher.isRunning())
+        return;
+    loadWatcher.cancel();
+    ui->statusbar->showMessage("Cancelling...");
+}
+
+void MainWindow::onLoadFinished()
+{
+    ui->btnLoad->setEnabled(true);
+    ui->btnCancel->setEnabled(false);
+
+    const QFuture<PipelineResult> future = loadWatcher.future();
+    if (future.isCanceled() || future.resultCount() == 0) {
+        ui->statusbar->showMessage("Load cancelled", 5000);
+        log("Load cancelled");
+        return;
+    }
+
+    const PipelineResult result = future.result();
+    for (const QString &line : result.messages)
+        log(line);
+    ui->statusbar->showMessage(QString("Loaded %1").arg(QFileInfo(result.source).fileName()), 5000);
+    if (result.mbnMatrix.isEmpty())
+        return;
+
+    mbnMatrix      = result.mbnMatrix;
+    envelopeMatrix = result.envelopeMatrix;
+    signalFeatures = result.features;
+    mbnFs          = result.mbnFs;
+    envelopeFs     = result.envelopeFs;
+    limitDecimation(mbnFs);
+
+    currentIndex = 0;
+    plotTimeDomain(currentIndex);
+    analyzeSignalFeatures(currentIndex);
+}
+
+void MainWindow::on_chkFollow_toggled(bool checked)
+{
+    if (!checked) {
+        stopFollowing();
+        return;
+    }
+
+    if (loadWatcher.isRunning()) {
+        log("A file is still loading");
+        ui->chkFollow->setChecked(false);
+        return;
+    }
+
+    const QString path = ui->editDir->text();
+    QFileInfo fi(path);
+    if (path.isEmpty() || !fi.exists() || !fi.isFile()) {
+        log("Specified path is not a valid file");
+        ui->chkFollow->setChecked(false);
+        return;
+    }
+
+    if (!startFollowing(path)) {
+        log("Cannot follow: " + path);
+        ui->chkFollow->setChecked(false);
+    }
+}
+
+bool MainWindow::startFollowing(const QString &path)
+{
+    if (!tailReader.open(path))
+        return false;
+
+    const CaptureLayout &layout = tailReader.layout();
+    const double fs = layout.fs > 0.0 ? layout.fs : kDefaultMBNSampleRate;
+    liveProcessor.reset(layout.recordLength, layout.channels, fs);
+    limitDecimation(fs);
+    liveMin = liveMax = 0.0;
+    livePeaks.reset(fs, 0.0, int(fs * kLivePeakLookbackSec));
+    liveEnvelopeMax = 0.0;
+    livePeakCount = 0;
+
+    // Final rows go to a series that onFollowTick only appends to; the rows still waiting
+    // for channels are a second series, replaced on every tick
+    QChart *chart = new QChart();
+    chart->setTitle("MBN Curve (following)");
+    liveSeries = new QLineSeries();
+    liveSeries->setName("Final");
+    chart->addSeries(liveSeries);
+    liveProvisional = new QLineSeries();
+    liveProvisional->setName("Provisional");
+    liveProvisional->setColor(Qt::gray);
+    chart->addSeries(liveProvisional);
+
+    QValueAxis *axisX = new QValueAxis();
+    axisX->setTitleText("Time (sample index)");
+    axisX->setRange(0, layout.recordLength);
+    liveAxisY = new QValueAxis();
+    liveAxisY->setTitleText("MBN Amplitude");
+    chart->addAxis(axisX, Qt::AlignBottom);
+    chart->addAxis(liveAxisY, Qt::AlignLeft);
+    liveSeries->attachAxis(axisX);
+    liveSeries->attachAxis(liveAxisY);
+    liveProvisional->attachAxis(axisX);
+    liveProvisional->attachAxis(liveAxisY);
+    ui->widget->setChart(chart);
+
+    ui->btnLoad->setEnabled(false);
+    log(QString("Following %1 (%2 channels x %3 samples)")
+            .arg(QFileInfo(path).fileName()).arg(layout.channels).arg(layout.recordLength));
+    log("Samples arrive channel by channel: the curve, Mean and RMS are running averages of "
+        "the channels received until the last one arrives; live peaks use final rows only");
+    followTimer.start();
+    onFollowTick();
+    return true;
+}
+
+void MainWindow::stopFollowing()
+{
+    followTimer.stop();
+    tailReader.close();
+    liveSeries = nullptr;
+    liveProvisional = nullptr;
+    liveAxisY = nullptr;
+    ui->btnLoad->setEnabled(true);
+}
+
+void MainWindow::onFollowTick()
+{
+    // Only the rows appended since the last tick are read, averaged, filtered and drawn
+    // (plus the provisional part of the curve, which is redrawn)
+    QVector<double> rows;
+    const int fetched = tailReader.fetchNew(rows);
+    QString failure;
+    if (fetched < 0)
+        failure = tailReader.isOpen() ? "could not read the new rows" : "the capture is no longer open";
+    else if (liveProcessor.append(rows.constData(), fetched) < 0)
+        failure = "capture is larger than its layout";
+    if (!failure.isEmpty()) {
+        log("Follow stopped: " + failure);
+        ui->chkFollow->setChecked(false);
+        return;
+    }
+
+    const DoubleVector &mbn = liveProcessor.average();
+    const int from = liveSeries ? liveSeries->count() : mbn.size();
+    if (from < mbn.size()) {
+        QList<QPointF> points;
+        points.reserve(mbn.size() - from);
+        for (int i = from; i < mbn.size(); ++i) {
+            if (i == 0)
+                liveMin = liveMax = mbn[i];
+            liveMin = std::min(liveMin, mbn[i]);
+            liveMax = std::max(liveMax, mbn[i]);
+            points.append(QPointF(i, mbn[i]));
+        }
+        liveSeries->append(points);
+    }
+
+    // Rows that still miss channels: their running average, as the lowest and highest
+    // value of each bucket in sample order
+    const int provisional = liveProcessor.provisionalCount();
+    if (liveProvisional) {
+        QList<QPointF> points;
+        const int first = mbn.size();
+        const int step = std::max(1, (provisional - first + kMaxProvisionalBuckets - 1)
+                                         / kMaxProvisionalBuckets);
+        for (int i = first; i < provisional; i += step) {
+            const int end = std::min(provisional, i + step);
+            int lo = i, hi = i;
+            double vLo = liveProcessor.provisionalAverage(i), vHi = vLo;
+            for (int j = i + 1; j < end; ++j) {
+                const double v = liveProcessor.provisionalAverage(j);
+                if (v < vLo) { vLo = v; lo = j; }
+                if (v > vHi) { vHi = v; hi = j; }
+            }
+            if (i == 0)
+                liveMin = liveMax = vLo;
+            liveMin = std::min(liveMin, vLo);
+            liveMax = std::max(liveMax, vHi);
+            points.append(QPointF(std::min(lo, hi), lo < hi ? vLo : vHi));
+            if (lo != hi)
+                points.append(QPointF(std::max(lo, hi), lo < hi ? vHi : vLo));
+        }
+        liveProvisional->replace(points);
+    }
+    if (liveAxisY && (from < mbn.size() || mbn.size() < provisional))
+        liveAxisY->setRange(liveMin, liveMax);
+
+    const CaptureLayout &layout = tailReader.layout();
+    const double fs = layout.fs > 0.0 ? layout.fs : kDefaultMBNSampleRate;
+
+    // Peaks of the live (causal square-law) envelope as they are confirmed. The
+    // prominence threshold is the batch ratio (0.2) of the highest envelope value so far,
+    // so early peaks may not survive the final analysis.
+    const DoubleVector &env = liveProcessor.envelope();
+    const int fed = int(livePeaks.sampleCount());
+    if (fed < env.size()) {
+        for (int i = fed; i < env.size(); ++i)
+            liveEnvelopeMax = std::max(liveEnvelopeMax, env[i]);
+        livePeaks.setMinProminence(0.2 * liveEnvelopeMax);
+        QVector<StreamingPeakDetector::Peak> confirmed;
+        livePeaks.process(env.constData() + fed, env.size() - fed, confirmed);
+        for (const StreamingPeakDetector::Peak &p : confirmed) {
+            log(QString("Live peak at %1 s: amplitude=%2, FWHM=%3 s, ratio=%4")
+                    .arg(p.position / fs, 0, 'f', 4)
+                    .arg(p.info.amplitude, 0, 'f', 3)
+                    .arg(p.info.fwhm,      0, 'f', 6)
+                    .arg(p.info.ratio,     0, 'f', 3));
+        }
+        livePeakCount += confirmed.size();
+    }
+
+    double meanAbs = liveProcessor.meanAbs(), rms = liveProcessor.rms();
+    QString provisionalNote;
+    if (mbn.size() < provisional) {
+        liveProcessor.provisionalStats(meanAbs, rms);
+        provisionalNote = QString(" (provisional, %1 of %2 samples final)")
+                              .arg(mbn.size()).arg(layout.recordLength);
+    }
+    ui->statusbar->showMessage(QString("Following: %1 / %2 rows, Mean=%3, RMS=%4, Peaks=%5%6")
+                                   .arg(tailReader.lastRowId())
+                                   .arg(qint64(layout.channels) * layout.recordLength)
+                                   .arg(meanAbs, 0, 'g', 6)
+                                   .arg(rms, 0, 'g', 6)
+                                   .arg(livePeakCount)
+                                   .arg(provisionalNote));
+
+    if (!liveProcessor.isComplete())
+        return;
+
+    // Capture finished: hand it over to the normal views; ringing and the final peaks
+    // need the whole signal, so they are computed once here
+    // The live envelope is causal and at full rate; zero-phase or decimated envelopes need
+    // the finished signal
+    const PipelineOptions options = pipelineOptions();
+    mbnMatrix = MBNMatrix{ liveProcessor.average() };
+    mbnFs = fs;
+    if (options.envelopeMethod == QLatin1String("square-law")
+        && options.envelopeMode == EnvelopeMode::Causal && options.envelopeDecimation <= 1) {
+        envelopeMatrix = MBNMatrix{ liveProcessor.envelope() };
+        envelopeFs = mbnFs;
+    } else {
+        envelopeMatrix = computeEnvelopes(mbnMatrix, mbnFs, options, envelopeFs);
+    }
+    signalFeatures = { computeSignalFeatures(mbnMatrix[0], envelopeMatrix[0], envelopeFs,
+                                             options.maxPeaks) };
+    log("Capture complete");
+    ui->chkFollow->setChecked(false);
+
+    currentIndex = 0;
+    plotTimeDomain(currentIndex);
+    analyzeSignalFeatures(currentIndex);
+}
+
+void MainWindow::limitDecimation(double fs)
+{
+    // The spin box allows the factor for the rigs' 100 kHz; other rates lower it
+    const int maxDecimation = maxEnvelopeDecimation(fs);
+    if (ui->spinDecimation->value() > maxDecimation)
+        log(QString("Decimation limited to %1 at %2 Hz").arg(maxDecimation).arg(fs));
+    ui->spinDecimation->setMaximum(maxDecimation);
+}
+
+void MainWindow::on_comboEnvelope_currentTextChanged(const QString &method)
+{
+    // Zero-phase filtering and decimation only exist for the square-law detector
+    const bool squareLaw = method == QLatin1String("square-law");
+    ui->chkZeroPhase->setEnabled(squareLaw);
+    ui->spinDecimation->setEnabled(squareLaw);
+}
+
+void MainWindow::on_btnPlotTime_clicked()
+{
+    if (mbnMatrix.isEmpty()) {
+        log("No data detected");
+        return;
+    }
+    plotTimeDomain(currentIndex);
+    analyzeSignalFeatures(currentIndex);
+}
+
+void MainWindow::on_btnPlotFreq_clicked()
+{
+    if (mbnMatrix.isEmpty()) {
+        log("No data detected");
+        return;
+    }
+    plotFrequencySpectrum(currentIndex);
+}
+
+void MainWindow::on_btnPlotEnv_clicked()
+{
+    if (envelopeMatrix.isEmpty()) {
+        log("No data detected");
+        return;
+    }
+    plotEnvelope(currentIndex);
+    analyzeSignalFeatures(currentIndex);
+}
+
+void MainWindow::plotTimeDomain(int /*index*/)
+{
+    QChart *chart = new QChart();
+
+    for (const DoubleVector &mbn : mbnMatrix) {
+        QLineSeries *series = new QLineSeries();
+        for (int i = 0; i < mbn.size(); ++i) {
+            series->append(i, mbn[i]);
+        }
+        chart->addSeries(series);
+    }
+
+    chart->createDefaultAxes();
+    chart->setTitle("MBN Curves");
+
+    chart->axisX()->setTitleText("Time (sample index)");
+    chart->axisY()->setTitleText("MBN Amplitude");
+
+    ui->widget->setChart(chart);
+}
+
+void MainWindow::plotFrequencySpectrum(int index)
+{
+    if (index < 0 || index >= mbnMatrix.size())
+        return;
+
+    QChart *chart = new QChart();
+    chart->setTitle("Frequency Spectrum");
+
+    const double fs = mbnFs;
+    const DoubleVector &mbn = mbnMatrix[index];
+    int N = mbn.size();
+    if (N == 0) {
+        ui->widget->setChart(chart);
+        return;
+    }
+
+    int Nfft = 1 << static_cast<int>(std::ceil(std::log2(N)));
+
+    std::vector<kiss_fft_cpx> in(Nfft), out(Nfft);
+
+    for (int i = 0; i < N; ++i) {
+        in[i].r = mbn[i];
+        in[i].i = 0;
+    }
+    for (int i = N; i < Nfft; ++i) {
+        in[i].r = in[i].i = 0;
+    }
+
+    kiss_fft(fftPlan(Nfft, false), in.data(), out.data());
+
+    int M = Nfft/2 + 1;
+    QVector<double> P1(M), freq(M);
+    for (int i = 0; i < M; ++i) {
+        double mag = std::hypot(out[i].r, out[i].i) / Nfft;
+        if (i != 0 && i != Nfft/2)
+            mag *= 2.0;
+        P1[i]   = mag;
+        freq[i] = fs * i / Nfft;
+    }
+
+    QLineSeries *series = new QLineSeries();
+    for (int i = 0; i < M; ++i) {
+        series->append(freq[i], P1[i]);
+    }
+    chart->addSeries(series);
+
+    chart->createDefaultAxes();
+    chart->axisX()->setTitleText("Frequency (Hz)");
+    chart->axisY()->setTitleText("Amplitude");
+    ui->widget->setChart(chart);
+    ui->widget->setRenderHint(QPainter::Antialiasing);
+}
+
+void MainWindow::plotEnvelope(int /*index*/)
+{
+    QChart *chart = new QChart();
+    chart->setTitle("Signals & Envelopes");
+
+    for (int i = 0; i < mbnMatrix.size(); ++i) {
+        QLineSeries *sRaw = new QLineSeries();
+        QLineSeries *sEnv = new QLineSeries();
+        sRaw->setName(QString("MBN Raw %1").arg(i + 1));
+        sEnv->setName(QString("Envelope %1").arg(i + 1));
+
+        // A decimated envelope has fewer samples; place them on the MBN sample axis
+        const DoubleVector &raw = mbnMatrix[i];
+        const DoubleVector &env = envelopeMatrix[i];
+        const double envStep = mbnFs / envelopeFs;
+        for (int j = 0; j < raw.size(); ++j)
+            sRaw->append(j, raw[j]);
+        for (int j = 0; j < env.size(); ++j)
+            sEnv->append(j * envStep, env[j]);
+
+        chart->addSeries(sRaw);
+        chart->addSeries(sEnv);
+    }
+
+    chart->createDefaultAxes();
+
+    chart->axisX()->setTitleText("Time (sample index)");
+    chart->axisY()->setTitleText("Amplitude");
+
+    ui->widget->setChart(chart);
+    ui->widget->setRenderHint(QPainter::Antialiasing);
+}
@@ -1,39 +1,72 @@
-#pragma once
-
-#include <QMainWindow>
-#include "signalprocessor.h"  // 你需要的类型定义
-#include "dbloader.h"
-
-QT_BEGIN_NAMESPACE
-namespace Ui { class MainWindow; }
-QT_END_NAMESPACE
-
-class MainWindow : public QMainWindow {
-    Q_OBJECT
-public:
-    explicit MainWindow(QWidget *parent = nullptr);
-    ~MainWindow();  // 仅声明
-
-private slots:
-    void on_btnBrowse_clicked();
-    void on_btnLoad_clicked();
-    void on_btnPlotTime_clicked();
-    void on_btnPlotFreq_clicked();
-    void on_btnPlotEnv_clicked();
-
-private:
-    Ui::MainWindow *ui;
-    MBNMatrix mbnMatrix;
-    MBNMatrix envelopeMatrix;
-    int currentIndex = 0;
-    void log(const QString &s);
-    void plotTimeDomain(int index);
-    void plotFrequencySpectrum(int index);
-    void plotEnvelope(int index);
-    void analyzeSignalFeatures(int index);
-};
-
-
-
-QVector<PeakInfo> findPeaksWithWidth(const QVector<double> &signal, double fs, double minProminenceRatio);
-int countRingingByPeaks(const QVector<double> &x, double thresholdRatio = 0.01);
+#pragma once
+
+#include <QMainWindow>
+#include <QFutureWatcher>
+#include <QTimer>
+#include "signalprocessor.h"  // 你需要的类型定义
+#include "dbloader.h"
+#include "mbnpipeline.h"
+#include "streamingpeaks.h"
+
+QT_BEGIN_NAMESPACE
+namespace Ui { class MainWindow; }
+QT_END_NAMESPACE
+
+class QLineSeries;
+class QValueAxis;
+
+class MainWindow : public QMainWindow {
+    Q_OBJECT
+public:
+    explicit MainWindow(QWidget *parent = nullptr);
+    ~MainWindow();  // 仅声明
+
+private slots:
+    void on_btnBrowse_clicked();
+    void on_btnLoad_clicked();
+    void on_btnCancel_clicked();
+    void onLoadFinished();
+    void on_chkFollow_toggled(bool checked);
+    void onFollowTick();
+    void on_comboEnvelope_currentTextChanged(const QString &method);
+    void on_btnPlotTime_clicked();
+    void on_btnPlotFreq_clicked();
+    void on_btnPlotEnv_clicked();
+
+private:
+    Ui::MainWindow *ui;
+    MBNMatrix mbnMatrix;
+    MBNMatrix envelopeMatrix;
+    QVector<SignalFeatures> signalFeatures;
+    double mbnFs = kDefaultMBNSampleRate;
+    double envelopeFs = kDefaultMBNSampleRate;
+    int currentIndex = 0;
+    QFutureWatcher<PipelineResult> loadWatcher;
+    // Follow mode: polls a capture that is still being written
+    QTimer followTimer;
+    DbTailReader tailReader;
+    LiveMBNProcessor liveProcessor;
+    QLineSeries *liveSeries = nullptr;
+    QLineSeries *liveProvisional = nullptr;   // rows still missing channels, redrawn per tick
+    QValueAxis *liveAxisY = nullptr;
+    double liveMin = 0.0;
+    double liveMax = 0.0;
+    // Envelope peaks reported while following, against a provisional threshold
+    StreamingPeakDetector livePeaks;
+    double liveEnvelopeMax = 0.0;
+    int livePeakCount = 0;
+    bool startFollowing(const QString &path);
+    void stopFollowing();
+    PipelineOptions pipelineOptions() const;
+    void limitDecimation(double fs);
+    void log(const QString &s);
+    void plotTimeDomain(int index);
+    void plotFrequencySpectrum(int index);
+    void plotEnvelope(int index);
+    void analyzeSignalFeatures(int index);
+};
+
+
+
+QVector<PeakInfo> findPeaksWithWidth(const QVector<double> &signal, double fs, double minProminenceRatio);
+int countRingingByPeaks(const QVector<double> &x, double thresholdRatio = 0.01);
@@ -0,0 +1,268 @@
+#include "mbncache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+static const char kCacheMagic[8] = { 'M', 'B', 'N', 'C', 'A', 'C', 'H', 'E' };
+static const quint32 kCacheVersion = 2;
+static const qint64 kCacheAlign = 64;
+
+static_assert(sizeof(MBNCacheHeader) == 64, "cache header must stay 64 bytes");
+static_assert(sizeof(MBNCacheEntry) == 72, "cache directory entry layout changed");
+static_assert(sizeof(PeakInfo) == 3 * sizeof(double), "PeakInfo is stored as raw doubles");
+
+static qint64 alignUp(qint64 offset)
+{
+    return (offset + kCacheAlign - 1) & ~(kCacheAlign - 1);
+}
+
+static QByteArray cacheKey(const QString &sourceFile, const QString &profile)
+{
+    return QFileInfo(sourceFile).absoluteFilePath().toUtf8() + '\n' + profile.toUtf8();
+}
+
+QString mbnCachePath(const QString &sourceFile, const QString &cacheDir)
+{
+    const QString dir = cacheDir.isEmpty()
+        ? QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/mbn"
+        : cacheDir;
+    const QByteArray hash = QCryptographicHash::hash(
+        QFileInfo(sourceFile).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return dir + "/" + QString::fromLatin1(hash) + ".mbncache";
+}
+
+bool writeMBNCache(const QString &sourceFile, const QString &profile,
+                   const MBNMatrix &mbnMatrix, const MBNMatrix &envelopeMatrix,
+                   const QVector<SignalFeatures> &features,
+                   double mbnFs, double envelopeFs, const QString &cacheDir)
+{
+    const int count = mbnMatrix.size();
+    if (envelopeMatrix.size() != count || features.size() != count)
+        return false;
+
+    const QFileInfo source(sourceFile);
+    const QByteArray key = cacheKey(sourceFile, profile);
+
+    // Lay out the file first so that the directory can be written in one go
+    MBNCacheHeader header{};
+    std::memcpy(header.magic, kCacheMagic, sizeof(header.magic));
+    header.version = kCacheVersion;
+    header.signalCount = quint32(count);
+    header.sourceSize = source.size();
+    header.sourceMTime = source.lastModified().toMSecsSinceEpoch();
+    header.directoryOffset = sizeof(MBNCacheHeader);
+    header.keyOffset = header.directoryOffset + qint64(count) * qint64(sizeof(MBNCacheEntry));
+    header.keyBytes = quint32(key.size());
+
+    QVector<MBNCacheEntry> directory(count);
+    qint64 offset = alignUp(header.keyOffset + key.size());
+    for (int i = 0; i < count; ++i) {
+        MBNCacheEntry &e = directory[i];
+        e.mbnLength = mbnMatrix[i].size();
+        e.envelopeLength = envelopeMatrix[i].size();
+        e.peakCount = features[i].peaks.size();
+        e.ringing = features[i].ringing;
+        e.meanAbs = features[i].meanAbs;
+        e.rms = features[i].rms;
+        e.mbnFs = mbnFs;
+        e.envelopeFs = envelopeFs;
+
+        e.mbnOffset = offset;
+        offset = alignUp(offset + qint64(e.mbnLength) * qint64(sizeof(double)));
+        e.envelopeOffset = offset;
+        offset = alignUp(offset + qint64(e.envelopeLength) * qint64(sizeof(double)));
+        e.peaksOffset = offset;
+        offset = alignUp(offset + qint64(e.peakCount) * qint64(sizeof(PeakInfo)));
+    }
+
+    const QString path = mbnCachePath(sourceFile, cacheDir);
+    if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+        return false;
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write cache:" << path << out.errorString();
+        return false;
+    }
+
+    // Everything stops at the first short write, so `written` is always the file position
+    qint64 written = 0;
+    bool ok = true;
+    auto put = [&](const void *data, qint64 bytes) {
+        if (!ok)
+            return;
+        ok = out.write(static_cast<const char *>(data), bytes) == bytes;
+        if (ok)
+            written += bytes;
+    };
+    // Every section starts at the next kCacheAlign boundary, so a gap is always shorter
+    auto padTo = [&](qint64 target) {
+        static const char zeros[kCacheAlign] = {};
+        const qint64 gap = target - written;
+        Q_ASSERT(gap < kCacheAlign);
+        if (gap > 0)
+            put(zeros, std::min(gap, kCacheAlign));
+    };
+
+    put(&header, sizeof(header));
+    put(directory.constData(), qint64(count) * qint64(sizeof(MBNCacheEntry)));
+    put(key.constData(), key.size());
+    for (int i = 0; ok && i < count; ++i) {
+        const MBNCacheEntry &e = directory[i];
+        padTo(e.mbnOffset);
+        put(mbnMatrix[i].constData(), qint64(e.mbnLength) * qint64(sizeof(double)));
+        padTo(e.envelopeOffset);
+        put(envelopeMatrix[i].constData(), qint64(e.envelopeLength) * qint64(sizeof(double)));
+        padTo(e.peaksOffset);
+        put(features[i].peaks.constData(), qint64(e.peakCount) * qint64(sizeof(PeakInfo)));
+    }
+    padTo(offset);
+
+    if (!ok || written != offset) {
+        out.cancelWriting();
+        qWarning() << "Cannot write cache:" << path << out.errorString();
+        return false;
+    }
+    return out.commit();
+}
+
+bool MBNCacheReader::open(const QString &sourceFile, const QString &profile, const QString &cacheDir)
+{
+    close();
+
+    const QString path = mbnCachePath(sourceFile, cacheDir);
+    if (!QFile::exists(path))
+        return false;
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    mappedSize = file.size();
+    if (mappedSize < qint64(sizeof(MBNCacheHeader)) || !(base = file.map(0, mappedSize))) {
+        close();
+        return false;
+    }
+
+    const MBNCacheHeader *header = reinterpret_cast<const MBNCacheHeader *>(base);
+    const QFileInfo source(sourceFile);
+    const QByteArray key = cacheKey(sourceFile, profile);
+
+    bool valid = std::memcmp(header->magic, kCacheMagic, sizeof(kCacheMagic)) == 0
+                 && header->version == kCacheVersion
+                 && header->sourceSize == source.size()
+                 && header->sourceMTime == source.lastModified().toMSecsSinceEpoch()
+                 && header->directoryOffset >= qint64(sizeof(MBNCacheHeader))
+                 && header->directoryOffset
+                        + qint64(header->signalCount) * qint64(sizeof(MBNCacheEntry)) <= mappedSize
+                 && header->keyBytes == quint32(key.size())
+                 && header->keyOffset >= 0
+                 && header->keyOffset + header->keyBytes <= mappedSize
+                 && std::memcmp(base + header->keyOffset, key.constData(), size_t(key.size())) == 0;
+
+    // Every array has to lie inside the mapping before any pointer is handed out
+    for (int i = 0; valid && i < int(header->signalCount); ++i) {
+        const MBNCacheEntry &e = entry(i);
+        auto inside = [this](qint64 off, qint64 bytes) {
+            return off >= 0 && bytes >= 0 && off % kCacheAlign == 0 && off + bytes <= mappedSize;
+        };
+        valid = e.mbnLength >= 0 && e.envelopeLength >= 0 && e.peakCount >= 0
+                && inside(e.mbnOffset, qint64(e.mbnLength) * qint64(sizeof(double)))
+                && inside(e.envelopeOffset, qint64(e.envelopeLength) * qint64(sizeof(double)))
+                && inside(e.peaksOffset, qint64(e.peakCount) * qint64(sizeof(PeakInfo)));
+    }
+
+    if (!valid) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MBNCacheReader::close()
+{
+    if (base)
+        file.unmap(base);
+    base = nullptr;
+    mappedSize = 0;
+    if (file.isOpen())
+        file.close();
+}
+
+const MBNCacheEntry &MBNCacheReader::entry(int index) const
+{
+    const MBNCacheHeader *header = reinterpret_cast<const MBNCacheHeader *>(base);
+    return reinterpret_cast<const MBNCacheEntry *>(base + header->directoryOffset)[index];
+}
+
+int MBNCacheReader::signalCount() const
+{
+    return base ? int(reinterpret_cast<const MBNCacheHeader *>(base)->signalCount) : 0;
+}
+
+const double *MBNCacheReader::mbn(int index) const
+{
+    return reinterpret_cast<const double *>(base + entry(index).mbnOffset);
+}
+
+int MBNCacheReader::mbnLength(int index) const
+{
+    return entry(index).mbnLength;
+}
+
+const double *MBNCacheReader::envelope(int index) const
+{
+    return reinterpret_cast<const double *>(base + entry(index).envelopeOffset);
+}
+
+int MBNCacheReader::envelopeLength(int index) const
+{
+    return entry(index).envelopeLength;
+}
+
+double MBNCacheReader::mbnFs(int index) const
+{
+    return entry(index).mbnFs;
+}
+
+double MBNCacheReader::envelopeFs(int index) const
+{
+    return entry(index).envelopeFs;
+}
+
+SignalFeatures MBNCacheReader::features(int index) const
+{
+    const MBNCacheEntry &e = entry(index);
+    const PeakInfo *peaks = reinterpret_cast<const PeakInfo *>(base + e.peaksOffset);
+
+    SignalFeatures f;
+    f.meanAbs = e.meanAbs;
+    f.rms = e.rms;
+    f.ringing = e.ringing;
+    f.peaks = QVector<PeakInfo>(peaks, peaks + e.peakCount);
+    return f;
+}
+
+void MBNCacheReader::toMatrices(MBNMatrix &mbnMatrix, MBNMatrix &envelopeMatrix,
+                                QVector<SignalFeatures> &features) const
+{
+    const int count = signalCount();
+    mbnMatrix.clear();
+    envelopeMatrix.clear();
+    features.clear();
+    mbnMatrix.reserve(count);
+    envelopeMatrix.reserve(count);
+    features.reserve(count);
+
+    for (int i = 0; i < count; ++i) {
+        mbnMatrix << DoubleVector(mbn(i), mbn(i) + mbnLength(i));
+        envelopeMatrix << DoubleVector(envelope(i), envelope(i) + envelopeLength(i));
+        features << this->features(i);
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <QFile>
+#include <QString>
+#include "signalprocessor.h"
+
+// On-disk cache of processed signals, one file per source .db:
+//   [header 64 B][directory: one entry per signal][key: source path + '\n' + profile]
+//   [64-byte aligned arrays: averaged MBN, envelope, peaks]
+// Values are stored in host byte order; the cache is local to the machine that wrote it.
+// A cache file is valid only while the source keeps the size and mtime stored in the header
+// and the caller asks for the same processing profile.
+
+struct MBNCacheHeader {
+    char magic[8];           // "MBNCACHE"
+    quint32 version;
+    quint32 signalCount;
+    qint64 sourceSize;
+    qint64 sourceMTime;      // ms since epoch
+    qint64 directoryOffset;
+    qint64 keyOffset;
+    quint32 keyBytes;
+    quint32 reserved[3];
+};
+
+struct MBNCacheEntry {
+    qint64 mbnOffset;
+    qint64 envelopeOffset;
+    qint64 peaksOffset;      // PeakInfo[peakCount]
+    qint32 mbnLength;
+    qint32 envelopeLength;
+    qint32 peakCount;
+    qint32 ringing;
+    double meanAbs;
+    double rms;
+    double mbnFs;            // sample rate of the averaged MBN signal
+    double envelopeFs;       // sample rate of the (possibly decimated) envelope
+};
+
+// Cache file used for sourceFile (under the user cache directory unless cacheDir is given)
+QString mbnCachePath(const QString &sourceFile, const QString &cacheDir = QString());
+
+bool writeMBNCache(const QString &sourceFile, const QString &profile,
+                   const MBNMatrix &mbnMatrix, const MBNMatrix &envelopeMatrix,
+                   const QVector<SignalFeatures> &features,
+                   double mbnFs, double envelopeFs,
+                   const QString &cacheDir = QString());
+
+// Read-only view of a cache file through QFile::map; the pointers stay valid until close()
+class MBNCacheReader {
+public:
+    MBNCacheReader() = default;
+    ~MBNCacheReader() { close(); }
+
+    // Maps the cache of sourceFile; fails if it is missing, stale or written for another profile
+    bool open(const QString &sourceFile, const QString &profile,
+              const QString &cacheDir = QString());
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    int signalCount() const;
+    const double *mbn(int index) const;
+    int mbnLength(int index) const;
+    const double *envelope(int index) const;
+    int envelopeLength(int index) const;
+    double mbnFs(int index) const;
+    double envelopeFs(int index) const;
+    SignalFeatures features(int index) const;
+
+    // Copies the mapped arrays into the matrices used by the rest of the pipeline
+    void toMatrices(MBNMatrix &mbnMatrix, MBNMatrix &envelopeMatrix,
+                    QVector<SignalFeatures> &features) const;
+
+private:
+    const MBNCacheEntry &entry(int index) const;
+
+    QFile file;
+    uchar *base = nullptr;
+    qint64 mappedSize = 0;
+
+    MBNCacheReader(const MBNCacheReader &) = delete;
+    MBNCacheReader &operator=(const MBNCacheReader &) = delete;
+};
@@ -0,0 +1,120 @@
+#include "mbnpipeline.h"
+#include "mbncache.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <algorithm>
+
+// Bump whenever processing changes so that older cache files are ignored
+static const QString kProcessingRevision = QStringLiteral("v3");
+
+static QString cacheProfile(const PipelineOptions &options)
+{
+    QString profile = options.envelopeMethod + "/" + kProcessingRevision;
+    if (options.envelopeMode == EnvelopeMode::ZeroPhase)
+        profile += "/zero-phase";
+    if (options.envelopeDecimation > 1)
+        profile += QString("/decimate-%1").arg(options.envelopeDecimation);
+    if (options.maxPeaks > 0)
+        profile += QString("/top-%1").arg(options.maxPeaks);
+    return profile;
+}
+
+MBNMatrix computeEnvelopes(const MBNMatrix &mbnMatrix, double mbnFs,
+                           const PipelineOptions &options, double &envelopeFs)
+{
+    const EnvelopeMethod *method = findEnvelopeMethod(options.envelopeMethod);
+    if (!method) {
+        qWarning() << "Unknown envelope method" << options.envelopeMethod << "- using"
+                   << envelopeMethods().first().name;
+        method = &envelopeMethods().first();
+    }
+
+    EnvelopeParams params;
+    params.fs = mbnFs;
+    params.mode = options.envelopeMode;
+    // Clamped so that the envelope low-pass still fits below the reduced Nyquist frequency
+    params.decimation = std::min(options.envelopeDecimation,
+                                 maxEnvelopeDecimation(mbnFs, params.cutoffHz));
+    return method->extract(mbnMatrix, params, envelopeFs);
+}
+
+// Progress range of each stage
+static const int kLoadEnd = 70;
+static const int kEnvelopeEnd = 85;
+static const int kFeaturesEnd = 95;
+
+void runLoadPipeline(QPromise<PipelineResult> &promise, const QString &path,
+                     const PipelineOptions &options)
+{
+    promise.setProgressRange(0, 100);
+    const QString profile = cacheProfile(options);
+
+    PipelineResult result;
+    result.source = QFileInfo(path).absoluteFilePath();
+
+    // Unchanged file analysed before: map the cached results instead of reprocessing
+    promise.setProgressValueAndText(0, "Checking cache");
+    MBNCacheReader cache;
+    if (cache.open(path, profile)) {
+        cache.toMatrices(result.mbnMatrix, result.envelopeMatrix, result.features);
+        if (cache.signalCount() > 0) {
+            result.mbnFs = cache.mbnFs(0);
+            result.envelopeFs = cache.envelopeFs(0);
+        }
+        result.fromCache = true;
+        result.messages << QString("Loaded %1 MBN signals from cache").arg(result.mbnMatrix.size());
+        promise.setProgressValueAndText(100, "Loaded from cache");
+        promise.addResult(result);
+        return;
+    }
+
+    // Stream the file in place (read-only) straight into the channel average
+    promise.setProgressValueAndText(0, "Loading");
+    DoubleVector MBN;
+    CaptureLayout layout;
+    const bool loaded = processMBNStreaming(path, MBN, 16384, [&promise](qint64 received, qint64 total) {
+        if (total > 0)
+            promise.setProgressValue(int(kLoadEnd * received / total));
+        return !promise.isCanceled();
+    }, &layout);
+    if (promise.isCanceled())
+        return;
+    if (!loaded) {
+        result.messages << "No data loaded: file cannot be opened or contains no valid MBN data";
+        promise.addResult(result);
+        return;
+    }
+    result.messages << QString("Loaded %1").arg(QFileInfo(path).fileName());
+    result.mbnMatrix = MBNMatrix{ MBN };
+    if (layout.fs > 0.0)
+        result.mbnFs = layout.fs;
+
+    if (options.envelopeMethod == QLatin1String("square-law")
+        && options.envelopeDecimation > maxEnvelopeDecimation(result.mbnFs)) {
+        result.messages << QString("Decimation %1 is too high for %2 Hz sampling - using %3")
+                               .arg(options.envelopeDecimation).arg(result.mbnFs)
+                               .arg(maxEnvelopeDecimation(result.mbnFs));
+    }
+
+    promise.setProgressValueAndText(kLoadEnd, "Extracting envelopes");
+    result.envelopeMatrix = computeEnvelopes(result.mbnMatrix, result.mbnFs, options, result.envelopeFs);
+    result.messages << QString("Processed %1 valid MBN signals").arg(result.mbnMatrix.size());
+    if (promise.isCanceled())
+        return;
+
+    promise.setProgressValueAndText(kEnvelopeEnd, "Computing features");
+    for (int i = 0; i < result.mbnMatrix.size(); ++i) {
+        result.features << computeSignalFeatures(result.mbnMatrix[i], result.envelopeMatrix[i],
+                                                  result.envelopeFs, options.maxPeaks);
+        if (promise.isCanceled())
+            return;
+    }
+
+    promise.setProgressValueAndText(kFeaturesEnd, "Writing cache");
+    if (!writeMBNCache(path, profile, result.mbnMatrix, result.envelopeMatrix, result.features,
+                       result.mbnFs, result.envelopeFs))
+        result.messages << "Could not write the signal cache";
+
+    promise.setProgressValueAndText(100, "Done");
+    promise.addResult(result);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <QPromise>
+#include <QStringList>
+#include "envelopemethods.h"
+
+// Everything the GUI needs after loading one capture
+struct PipelineResult {
+    QString source;
+    MBNMatrix mbnMatrix;
+    MBNMatrix envelopeMatrix;
+    QVector<SignalFeatures> features;
+    double mbnFs = kDefaultMBNSampleRate;        // rate of the MBN signals
+    double envelopeFs = kDefaultMBNSampleRate;   // rate of the envelopes (lower when decimated)
+    bool fromCache = false;
+    QStringList messages;    // log lines, shown by the GUI thread
+};
+
+// Processing choices; everything here changes the results and is part of the cache key
+struct PipelineOptions {
+    QString envelopeMethod = QStringLiteral("square-law");   // a name from envelopeMethods()
+    // Square-law only (see EnvelopeParams)
+    EnvelopeMode envelopeMode = EnvelopeMode::Causal;
+    // > 1 selects the multi-rate detector (extractEnvelopesMultirate) with this factor
+    int envelopeDecimation = 1;
+    // > 0 keeps only this many of the highest envelope peaks per signal
+    int maxPeaks = 0;
+};
+
+// Envelopes of signals sampled at mbnFs with the method and settings of the options;
+// envelopeFs receives the rate of the returned envelopes
+MBNMatrix computeEnvelopes(const MBNMatrix &mbnMatrix, double mbnFs,
+                           const PipelineOptions &options, double &envelopeFs);
+
+// Load/process pipeline for one .db file, meant to run on a worker thread through
+// QtConcurrent::run: cache lookup, streaming load + average, envelopes, features and
+// cache write. Progress (0..100) and the current stage are reported on the promise;
+// the pipeline checks isCanceled() between stages and after every loaded chunk and
+// returns without a result once cancelled.
+void runLoadPipeline(QPromise<PipelineResult> &promise, const QString &path,
+                     const PipelineOptions &options);
@@ -0,0 +1,353 @@
+#include "parallelpeaks.h"
+#include "simdkernels.h"
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Samples per block of the max/min tree; a search first scans its own block, so this is
+// also the longest scan before the tree is consulted
+const int kTreeBlock = 64;
+// Smallest chunk handed to a worker, in blocks
+const int kMinChunkBlocks = 4096;
+
+struct Chunk {
+    int begin, end;
+};
+
+// Block-aligned chunks, about four per thread so that uneven chunks balance out
+QVector<Chunk> splitIntoChunks(int n, int threads)
+{
+    const int blocks = (n + kTreeBlock - 1) / kTreeBlock;
+    const int perChunk = std::max(kMinChunkBlocks, (blocks + 4 * threads - 1) / (4 * threads));
+    QVector<Chunk> chunks;
+    for (int b = 0; b < blocks; b += perChunk)
+        chunks << Chunk{ b * kTreeBlock, std::min(n, (b + perChunk) * kTreeBlock) };
+    return chunks;
+}
+
+int threadCount(int maxThreads)
+{
+    return maxThreads > 0 ? maxThreads : QThread::idealThreadCount();
+}
+
+// Maximum and minimum of every kTreeBlock samples, in two implicit binary trees (node k
+// has children 2k and 2k+1, block b is leaf P+b). A block holding a NaN gets +inf / -inf
+// so that searches always look inside it, where the comparisons stop at the NaN as the
+// sample-by-sample scans do.
+class BlockTree {
+public:
+    struct Leaves {
+        QVector<double> hi, lo;
+        double largest = -std::numeric_limits<double>::infinity();   // NaN ignored
+    };
+
+    static Leaves summarise(const double *x, int begin, int end)
+    {
+        Leaves leaves;
+        for (int b = begin; b < end; b += kTreeBlock) {
+            double hi = -std::numeric_limits<double>::infinity(), lo = -hi;
+            bool nan = false;
+            for (int k = b; k < std::min(end, b + kTreeBlock); ++k) {
+                if (std::isnan(x[k])) {
+                    nan = true;
+                } else {
+                    hi = std::max(hi, x[k]);
+                    lo = std::min(lo, x[k]);
+                }
+            }
+            leaves.hi << (nan ? std::numeric_limits<double>::infinity() : hi);
+            leaves.lo << (nan ? -std::numeric_limits<double>::infinity() : lo);
+            leaves.largest = std::max(leaves.largest, hi);
+        }
+        return leaves;
+    }
+
+    BlockTree(const QList<Leaves> &chunks)
+    {
+        int blocks = 0;
+        for (const Leaves &c : chunks)
+            blocks += c.hi.size();
+        P = 1;
+        while (P < blocks)
+            P *= 2;
+        hi = QVector<double>(2 * P, -std::numeric_limits<double>::infinity());
+        lo = QVector<double>(2 * P, std::numeric_limits<double>::infinity());
+        int leaf = P;
+        for (const Leaves &c : chunks) {
+            std::copy(c.hi.constBegin(), c.hi.constEnd(), hi.begin() + leaf);
+            std::copy(c.lo.constBegin(), c.lo.constEnd(), lo.begin() + leaf);
+            leaf += c.hi.size();
+        }
+        for (int k = P - 1; k >= 1; --k) {
+            hi[k] = std::max(hi[2 * k], hi[2 * k + 1]);
+            lo[k] = std::min(lo[2 * k], lo[2 * k + 1]);
+        }
+    }
+
+    // Nearest block before b (or after b) whose maximum is >= v, or -1
+    int lastHighBefore(int b, double v) const
+    {
+        return lastBefore(b, hi, [v](double h) { return h >= v; });
+    }
+    int firstHighAfter(int b, double v) const
+    {
+        return firstAfter(b, hi, [v](double h) { return h >= v; });
+    }
+    // Nearest block before b (or after b) whose minimum is <= v, or -1
+    int lastLowBefore(int b, double v) const
+    {
+        return lastBefore(b, lo, [v](double l) { return l <= v; });
+    }
+    int firstLowAfter(int b, double v) const
+    {
+        return firstAfter(b, lo, [v](double l) { return l <= v; });
+    }
+
+    // Minimum over blocks [a, b)
+    double minOfBlocks(int a, int b) const
+    {
+        double m = std::numeric_limits<double>::infinity();
+        for (a += P, b += P; a < b; a /= 2, b /= 2) {
+            if (a & 1) m = std::min(m, lo[a++]);
+            if (b & 1) m = std::min(m, lo[--b]);
+        }
+        return m;
+    }
+
+private:
+    // Climbs from leaf b until a sibling on the wanted side matches, then descends into
+    // that sibling keeping to the side nearest b
+    template<class Match>
+    int lastBefore(int b, const QVector<double> &t, Match match) const
+    {
+        int k = P + b;
+        for (; k > 1; k /= 2) {
+            if ((k & 1) && match(t[k - 1])) {
+                k = k - 1;
+                break;
+            }
+        }
+        if (k <= 1)
+            return -1;
+        while (k < P)
+            k = match(t[2 * k + 1]) ? 2 * k + 1 : 2 * k;
+        return k - P;
+    }
+
+    template<class Match>
+    int firstAfter(int b, const QVector<double> &t, Match match) const
+    {
+        int k = P + b;
+        for (; k > 1; k /= 2) {
+            if (!(k & 1) && match(t[k + 1])) {
+                k = k + 1;
+                break;
+            }
+        }
+        if (k <= 1)
+            return -1;
+        while (k < P)
+            k = match(t[2 * k]) ? 2 * k : 2 * k + 1;
+        return k - P;
+    }
+
+    int P = 1;
+    QVector<double> hi, lo;
+};
+
+// The searches of findPeaksWithWidth, each a scan of the sample's own block followed, if
+// needed, by the tree and a scan of the block it points to
+class PeakResolver {
+public:
+    PeakResolver(const double *x, int n, const BlockTree &tree) : x(x), n(n), tree(tree) {}
+
+    // Height above the higher of the lowest points between i and the nearest sample
+    // >= x[i] on either side, as peakProminences
+    double prominence(int i) const
+    {
+        const double peak = x[i];
+        double minLeft = peak, minRight = peak;
+        const int block = i / kTreeBlock;
+
+        int L = i - 1;
+        for (; L >= block * kTreeBlock && x[L] < peak; --L)
+            minLeft = std::min(minLeft, x[L]);
+        if (L >= 0 && L < block * kTreeBlock) {
+            const int b = tree.lastHighBefore(block, peak);
+            minLeft = std::min(minLeft, tree.minOfBlocks(b + 1, block));
+            if (b >= 0) {
+                for (L = (b + 1) * kTreeBlock - 1; x[L] < peak; --L)
+                    minLeft = std::min(minLeft, x[L]);
+            }
+        }
+
+        int R = i + 1;
+        const int blockEnd = std::min(n, (block + 1) * kTreeBlock);
+        for (; R < blockEnd && x[R] < peak; ++R)
+            minRight = std::min(minRight, x[R]);
+        if (R < n && R >= blockEnd) {
+            const int b = tree.firstHighAfter(block, peak);
+            minRight = std::min(minRight, tree.minOfBlocks(block + 1, b < 0 ? blocks() : b));
+            if (b >= 0) {
+                for (R = b * kTreeBlock; x[R] < peak; ++R)
+                    minRight = std::min(minRight, x[R]);
+            }
+        }
+        return peak - std::max(minLeft, minRight);
+    }
+
+    // Half-maximum crossings: the nearest sample at or below half the peak on each side
+    // (or the signal ends; a peak at the last sample has no right side)
+    PeakInfo widthOf(int i, double fs) const
+    {
+        const double half = x[i] / 2.0;
+        const int block = i / kTreeBlock;
+
+        int L = i;
+        for (; L > 0 && L >= block * kTreeBlock && x[L] > half; --L) {}
+        if (L > 0 && L < block * kTreeBlock) {
+            const int b = tree.lastLowBefore(block, half);
+            L = 0;
+            if (b >= 0) {
+                for (L = (b + 1) * kTreeBlock - 1; L > 0 && x[L] > half; --L) {}
+            }
+        }
+
+        int R = i;
+        if (i < n - 1) {
+            const int blockEnd = std::min(n, (block + 1) * kTreeBlock);
+            for (; R < n - 1 && R < blockEnd && x[R] > half; ++R) {}
+            if (R < n - 1 && R >= blockEnd) {
+                const int b = tree.firstLowAfter(block, half);
+                R = n - 1;
+                if (b >= 0) {
+                    for (R = b * kTreeBlock; R < n - 1 && x[R] > half; ++R) {}
+                }
+            }
+        }
+
+        const double widthSec = double(R - L) / fs;
+        return { x[i], widthSec, x[i] / widthSec };
+    }
+
+private:
+    int blocks() const { return (n + kTreeBlock - 1) / kTreeBlock; }
+
+    const double *x;
+    int n;
+    const BlockTree &tree;
+};
+
+} // namespace
+
+QVector<PeakInfo> findPeaksWithWidthParallel(const QVector<double> &signal, double fs,
+                                             double minProminenceRatio, int maxThreads)
+{
+    const int N = signal.size();
+    if (N < 3)
+        return {};
+    const double *x = signal.constData();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount(maxThreads));
+    const QVector<Chunk> chunks = splitIntoChunks(N, pool.maxThreadCount());
+
+    // Block summaries per chunk, then the tree over all of them
+    const QList<BlockTree::Leaves> leaves = QtConcurrent::blockingMapped(
+        &pool, chunks, [x](const Chunk &c) { return BlockTree::summarise(x, c.begin, c.end); });
+    const BlockTree tree(leaves);
+    const PeakResolver resolver(x, N, tree);
+    // The maximum findPeaksWithWidth takes from std::max_element: NaN if x[0] is, else the
+    // largest of the other samples (the tree holds +inf for a block with a NaN)
+    double globalMax = x[0];
+    for (const BlockTree::Leaves &l : leaves) {
+        if (!std::isnan(globalMax))
+            globalMax = std::max(globalMax, l.largest);
+    }
+    const double promThresh = globalMax * minProminenceRatio;
+
+    // Strict interior maxima of each chunk, looking one sample beyond it on both sides
+    const QList<QVector<PeakInfo>> found = QtConcurrent::blockingMapped(
+        &pool, chunks, [&](const Chunk &c) {
+            QVector<PeakInfo> peaks;
+            const int begin = std::max(1, c.begin), end = std::min(N - 1, c.end);
+            if (begin >= end)
+                return peaks;
+            QVector<int> candidates((end - begin + 2) / 2 + 2);
+            const int count = localMaxima(x + begin - 1, end - begin + 2,
+                                          -std::numeric_limits<double>::infinity(),
+                                          candidates.data());
+            for (int k = 0; k < count; ++k) {
+                const int i = begin - 1 + candidates[k];
+                if (resolver.prominence(i) >= promThresh)
+                    peaks << resolver.widthOf(i, fs);
+            }
+            return peaks;
+        });
+
+    QVector<PeakInfo> peaks;
+    for (const QVector<PeakInfo> &p : found)
+        peaks << p;
+    // A rising last point, which has no right side
+    if (x[N - 1] > x[N - 2] && resolver.prominence(N - 1) >= promThresh)
+        peaks << resolver.widthOf(N - 1, fs);
+    return peaks;
+}
+
+int countRingingAboveParallel(const double *x, int N, double epsVal, int maxThreads)
+{
+    if (N < 2) return 0;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount(maxThreads));
+    const QVector<Chunk> chunks = splitIntoChunks(N, pool.maxThreadCount());
+
+    struct Counts {
+        int maxima = 0, minima = 0;
+    };
+    const QList<Counts> counts = QtConcurrent::blockingMapped(
+        &pool, chunks, [x, N, epsVal](const Chunk &c) {
+            Counts counts;
+            const int begin = std::max(1, c.begin), end = std::min(N - 1, c.end);
+            if (begin < end)
+                countLocalExtrema(x + begin - 1, end - begin + 2, epsVal, counts.maxima, counts.minima);
+            return counts;
+        });
+
+    // End points as in countRingingAbove
+    int posCount = 0, negCount = 0;
+    if (x[0] > x[1] && x[0] > epsVal) ++posCount;
+    if (-x[0] > -x[1] && -x[0] > epsVal) ++negCount;
+    for (const Counts &c : counts) {
+        posCount += c.maxima;
+        negCount += c.minima;
+    }
+    if (x[N - 1] > x[N - 2] && x[N - 1] > epsVal) ++posCount;
+    if (-x[N - 1] > -x[N - 2] && -x[N - 1] > epsVal) ++negCount;
+
+    int totalPeaks = posCount + negCount;
+    return static_cast<int>(std::ceil(totalPeaks / 2.0));
+}
+
+int countRingingByPeaksParallel(const QVector<double> &x, double thresholdRatio, int maxThreads)
+{
+    const int N = x.size();
+    if (N < 2) return 0;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount(maxThreads));
+    const QList<double> maxima = QtConcurrent::blockingMapped(
+        &pool, splitIntoChunks(N, pool.maxThreadCount()), [&x](const Chunk &c) {
+            double maxAbs = 0.0;
+            for (int i = c.begin; i < c.end; ++i)
+                maxAbs = std::max(maxAbs, std::abs(x[i]));
+            return maxAbs;
+        });
+    const double maxAbs = *std::max_element(maxima.constBegin(), maxima.constEnd());
+    return countRingingAboveParallel(x.constData(), N, thresholdRatio * maxAbs, maxThreads);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "signalprocessor.h"
+
+// Multi-threaded forms of findPeaksWithWidth and countRingingAbove for long captures. The
+// signal is cut into block-aligned chunks searched on a bounded QThreadPool (maxThreads
+// <= 0 means QThread::idealThreadCount()). Each chunk reads one sample past either end,
+// so extrema at the seams are found exactly once. Searches that run past a chunk go
+// through a tree of per-block maxima and minima built from all the chunks, so the
+// results are identical to the sequential functions, NaN samples included.
+
+// Signals at least this long are searched in parallel by computeSignalFeatures
+const int kParallelPeakMinSamples = 1 << 21;
+
+QVector<PeakInfo> findPeaksWithWidthParallel(const QVector<double> &signal, double fs,
+                                             double minProminenceRatio, int maxThreads = 0);
+int countRingingAboveParallel(const double *x, int n, double threshold, int maxThreads = 0);
+int countRingingByPeaksParallel(const QVector<double> &x, double thresholdRatio,
+                                int maxThreads = 0);
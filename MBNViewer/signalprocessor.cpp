@@ -1,240 +1,958 @@
-#include "signalprocessor.h"
-#include <algorithm>
-#include <cmath>
-#include <QDebug>
-
-
-// —————————————— Existing two functions ——————————————
-
-MBNMatrix processAllMBN(const QList<TableData> &allData)
-{
-    // Pre-allocate result container
-    MBNMatrix MBN_all;
-    MBN_all.reserve(allData.size());
-
-    const int rows = 100000;  // number of rows per column
-    const int cols = 5;       // total of 10 columns of data (sensor channels)
-
-    for (const TableData &table : allData)
-    {
-        // Extract raw MBN data and pre-allocate
-        DoubleVector MBN_raw;
-        MBN_raw.reserve(rows * cols);
-
-        // Extract the 2nd column (index 1), skip invalid rows with less than 4 columns
-        for (const RowData &row : table)
-        {
-            if (row.size() < 4)
-                continue;
-            MBN_raw << row[1].toDouble();
-        }
-
-        // If size mismatch, warn and skip
-        if (MBN_raw.size() != rows * cols) {
-            qWarning() << "MBN size mismatch, skipping table";
-            continue;
-        }
-
-        // Row-wise average (100,000 rows × 10 columns)
-        DoubleVector MBN(rows);
-        for (int i = 0; i < rows; ++i) {
-            double sum = 0.0;
-            for (int j = 0; j < cols; ++j) {
-                sum += MBN_raw[j * rows + i];
-            }
-            MBN[i] = sum / cols;
-        }
-
-        // Collect results
-        MBN_all << MBN;
-    }
-
-    return MBN_all;
-}
-
-QVector<double> butterworthFilter(const QVector<double> &x, double cutoffHz, double fs)
-{
-    int n = x.size();
-    QVector<double> y(n);
-
-    double Wn  = std::tan(M_PI * cutoffHz / fs);
-    double Wn2 = Wn * Wn;
-    double norm = 1.0 + std::sqrt(2.0) * Wn + Wn2;
-
-    double b0 = Wn2 / norm;
-    double b1 = 2.0 * b0;
-    double b2 = b0;
-    double a1 = 2.0 * (Wn2 - 1.0) / norm;
-    double a2 = (1.0 - std::sqrt(2.0) * Wn + Wn2) / norm;
-
-    for (int i = 0; i < n; ++i) {
-        double yv = b0 * x[i];
-        if (i > 0) yv += b1 * x[i - 1] - a1 * y[i - 1];
-        if (i > 1) yv += b2 * x[i - 2] - a2 * y[i - 2];
-        y[i] = yv;
-    }
-    return y;
-}
-
-
-MBNMatrix extractEnvelopes(const MBNMatrix &mbnMatrix)
-{
-    const double Fs = 10000.0;      // envelope sampling frequency (1 kHz)
-    const double cutoffHz = 20.0;   // low-pass cutoff frequency 2 Hz
-
-    MBNMatrix filterMBN;
-    filterMBN.reserve(mbnMatrix.size());
-
-    for (const DoubleVector &x1 : mbnMatrix) {
-        const int N = x1.size();
-        QVector<double> x2(N), env(N);
-
-        // Step 1: square detection (with factor 2)
-        for (int j = 0; j < N; ++j)
-            x2[j] = 2.0 * x1[j] * x1[j];
-
-        // Step 2: 2nd-order Butterworth low-pass (bilinear transform)
-        QVector<double> y = butterworthFilter(x2, cutoffHz, Fs);
-
-        // Step 3: square root recovery (multiply by 2 again)
-        for (int j = 0; j < N; ++j)
-            env[j] = 2.0 * std::sqrt(std::max(0.0, y[j]));
-
-        filterMBN << env;  // append to output matrix
-    }
-
-    return filterMBN;
-}
-
-
-// —————————————— New peak and ringing functions ——————————————
-
-static double calculateProminence(const QList<double> &sig, int idx) {
-    double peak = sig[idx];
-    int N = sig.size();
-    double minLeft = peak, minRight = peak;
-    for (int L = idx - 1; L >= 0 && sig[L] < peak; --L)
-        minLeft = std::min(minLeft, sig[L]);
-    for (int R = idx + 1; R < N && sig[R] < peak; ++R)
-        minRight = std::min(minRight, sig[R]);
-    double baseline = std::max(minLeft, minRight);
-    return peak - baseline;
-}
-
-QVector<PeakInfo> findPeaksWithWidth(const QVector<double> &signal, double fs, double minProminenceRatio)
-{
-    QVector<PeakInfo> peaks;
-    int N = signal.size();
-    if (N < 3) return peaks;
-
-    double globalMax = *std::max_element(signal.constBegin(), signal.constEnd());
-    double promThresh = globalMax * minProminenceRatio;
-
-    for (int i = 1; i < N - 1; ++i) {
-        if (signal[i] > signal[i - 1] && signal[i] > signal[i + 1]) {
-            double prom = calculateProminence(signal, i);
-            if (prom >= promThresh) {
-                double half = signal[i] / 2.0;
-                int L = i, R = i;
-                while (L > 0   && signal[L] > half)  --L;
-                while (R < N-1 && signal[R] > half) ++R;
-
-                double widthSec = double(R - L) / fs;
-                peaks.append({ signal[i], widthSec, signal[i] / widthSec });
-
-                int j = i + 1;
-                while (j < N && signal[j] == signal[i]) ++j;
-                i = j - 1;
-            }
-        }
-    }
-
-    // Check if the last point is a peak
-    if (signal.size() >= 2) {
-        int i = N - 1;
-        if (signal[i] > signal[i - 1]) {
-            double prom = calculateProminence(signal, i);
-            if (prom >= promThresh) {
-                double half = signal[i] / 2.0;
-                int L = i;
-                while (L > 0 && signal[L] > half) --L;
-
-                double widthSec = double(i - L) / fs;
-                peaks.append({ signal[i], widthSec, signal[i] / widthSec });
-            }
-        }
-    }
-
-    return peaks;
-}
-
-
-int countRingingByPeaks(const QVector<double> &x, double thresholdRatio = 0.01)
-{
-    int N = x.size();
-    if (N < 2) return 0;
-
-    // Compute amplitude threshold epsVal = thresholdRatio * max(|x|)
-    double maxAbs = 0.0;
-    for (double v : x) {
-        maxAbs = std::max(maxAbs, std::abs(v));
-    }
-    double epsVal = thresholdRatio * maxAbs;
-
-    int posCount = 0, negCount = 0;
-
-    // Start point i=0
-    if (x[0] > x[1] && x[0] > epsVal) ++posCount;
-    if (-x[0] > -x[1] && -x[0] > epsVal) ++negCount;
-
-    // Main loop i=1..N-2: positive and negative peaks; deduplicate flat regions
-    for (int i = 1; i < N - 1; ++i) {
-        if (x[i] > x[i - 1] && x[i] > x[i + 1] && x[i] > epsVal) {
-            ++posCount;
-            int j = i + 1; while (j < N && x[j] == x[i]) ++j;
-            i = j - 1;
-            continue;
-        }
-        double v = -x[i];
-        if (v > -x[i - 1] && v > -x[i + 1] && v > epsVal) {
-            ++negCount;
-            int j = i + 1; while (j < N && -x[j] == v) ++j;
-            i = j - 1;
-        }
-    }
-
-    // End point i=N-1
-    if (x[N - 1] > x[N - 2] && x[N - 1] > epsVal) ++posCount;
-    if (-x[N - 1] > -x[N - 2] && -x[N - 1] > epsVal) ++negCount;
-
-    // One ringing ≈ one positive peak + one negative peak, round up
-    int totalPeaks = posCount + negCount;
-    return static_cast<int>(std::ceil(totalPeaks / 2.0));
-}
-void analyzeAllPeaks(const MBNMatrix &envelopes,
-                     double fs, double minProminenceRatio, double ringingThresholdRatio)
-{
-    for (int idx = 0; idx < envelopes.size(); ++idx) {
-        const DoubleVector &env = envelopes[idx];
-
-        // 1) Peak detection (amplitude, FWHM (s), amplitude-to-width ratio)
-        QVector<PeakInfo> peaks = findPeaksWithWidth(env, fs, minProminenceRatio);
-
-        // 2) Ringing count
-        int ringing = countRingingByPeaks(env, ringingThresholdRatio);
-
-        // 3) Print
-        qDebug().noquote() << QString("=== Signal %1 Peak Features ===").arg(idx + 1);
-        qDebug().noquote() << QString("Ringing Count = %1").arg(ringing);
-
-        for (int j = 0; j < peaks.size(); ++j) {
-            const PeakInfo &p = peaks[j];
-            qDebug().noquote()
-                << QString("Peak %1: Amplitude=%2, FWHM=%3 s, Ratio=%4")
-                       .arg(j + 1)
-                       .arg(p.amplitude, 0, 'f', 6)
-                       .arg(p.fwhm,      0, 'f', 6)
-                       .arg(p.ratio,     0, 'f', 6);
-        }
-    }
-}
+#include "signalprocessor.h"
+#include "simdkernels.h"
+#include "decimator.h"
+#include "fftplan.h"
+#include "slidingstats.h"
+#include "parallelpeaks.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <QDebug>
+#include <QVarLengthArray>
+
+
+// —————————————— Existing two functions ——————————————
+
+// Row-wise average of a channel-major raw column (rows × cols)
+static bool averageChannels(const DoubleVector &MBN_raw, int rows, int cols, DoubleVector &MBN)
+{
+    // If size mismatch, warn and skip
+    if (rows <= 0 || cols <= 0 || MBN_raw.size() != qsizetype(rows) * cols) {
+        qWarning() << "MBN size mismatch, skipping table";
+        return false;
+    }
+
+    // Sums the repeat blocks as contiguous vectors (AVX2/SSE2/scalar picked at runtime)
+    MBN.resize(rows);
+    averageRepeatBlocks(MBN_raw.constData(), rows, cols, MBN.data());
+    return true;
+}
+
+MBNMatrix processAllMBN(const QList<TableData> &allData)
+{
+    // Pre-allocate result container
+    MBNMatrix MBN_all;
+    MBN_all.reserve(allData.size());
+
+    for (const TableData &table : allData)
+    {
+        // Extract raw MBN data and pre-allocate
+        DoubleVector MBN_raw;
+        MBN_raw.reserve(table.size());
+
+        // Extract the 2nd column (index 1), skip invalid rows with less than 4 columns
+        for (const RowData &row : table)
+        {
+            if (row.size() < 4)
+                continue;
+            MBN_raw << row[1].toDouble();
+        }
+
+        // Row-wise average; TableData carries no layout, so the default repeat count applies
+        const int cols = kDefaultMBNChannels;
+        DoubleVector MBN;
+        if (!averageChannels(MBN_raw, MBN_raw.size() / cols, cols, MBN))
+            continue;
+
+        // Collect results
+        MBN_all << MBN;
+    }
+
+    return MBN_all;
+}
+
+MBNMatrix processAllMBN(const DBColumnData &allData)
+{
+    MBNMatrix MBN_all;
+    MBN_all.reserve(allData.size());
+
+    // The loader already delivers column 1 as a contiguous buffer with its discovered layout
+    for (const RawColumn &raw : allData) {
+        DoubleVector MBN;
+        if (!averageChannels(raw.samples, raw.recordLength, raw.channels, MBN))
+            continue;
+        MBN_all << MBN;
+    }
+
+    return MBN_all;
+}
+
+ChannelAverager::ChannelAverager(int rows, int cols)
+{
+    reset(rows, cols);
+}
+
+void ChannelAverager::reset(int rows, int cols)
+{
+    this->rows = std::max(0, rows);
+    this->cols = std::max(0, cols);
+    receivedCount = 0;
+    sums.fill(0.0, this->rows);
+}
+
+bool ChannelAverager::add(const double *samples, int count)
+{
+    if (receivedCount + count > expected()) {
+        receivedCount += count;
+        return false;
+    }
+
+    double *acc = sums.data();
+    while (count > 0 && rows > 0) {
+        // Split the chunk at row wrap-around so that the inner loop is a plain vector add
+        const int i = int(receivedCount % rows);
+        const int n = std::min(count, rows - i);
+        accumulateBlock(acc + i, samples, n);
+        samples += n;
+        count -= n;
+        receivedCount += n;
+    }
+    return true;
+}
+
+int ChannelAverager::completedRows() const
+{
+    // Channel-major order: row r is complete once channel cols-1 has reached it
+    const qint64 done = receivedCount - qint64(cols - 1) * rows;
+    return int(std::clamp<qint64>(done, 0, rows));
+}
+
+double ChannelAverager::runningAverage(int row) const
+{
+    // Row r has one value from every full pass over the rows, plus one from the current pass
+    // once it has got that far
+    const qint64 blocks = std::min<qint64>(receivedCount / rows + (row < receivedCount % rows ? 1 : 0),
+                                           cols);
+    return blocks > 0 ? sums[row] / double(blocks) : 0.0;
+}
+
+bool ChannelAverager::result(DoubleVector &MBN) const
+{
+    if (rows == 0 || receivedCount != expected()) {
+        qWarning() << "MBN size mismatch, skipping table";
+        return false;
+    }
+
+    MBN.resize(rows);
+    for (int i = 0; i < rows; ++i)
+        MBN[i] = sums[i] / cols;
+    return true;
+}
+
+bool processMBNStreaming(const QString &dbFile, DoubleVector &MBN, int chunkRows,
+                         const StreamProgress &progress, CaptureLayout *layout)
+{
+    // The averager is sized from the discovered layout before the first chunk arrives
+    ChannelAverager averager;
+    const bool ok = streamDbFile(dbFile, [&](const double *samples, int count) {
+        return averager.add(samples, count)
+               && (!progress || progress(averager.received(), averager.expected()));
+    }, chunkRows, 1, [&averager, layout](const CaptureLayout &discovered) {
+        averager.reset(discovered.recordLength, discovered.channels);
+        if (layout)
+            *layout = discovered;
+        return true;
+    });
+
+    if (!ok) {
+        if (averager.received() > averager.expected())
+            qWarning() << "MBN size mismatch, skipping table";
+        return false;
+    }
+    return averager.result(MBN);
+}
+
+// Kept for callers of the old API; designs a 2nd-order Butterworth SOS filter per call
+QVector<double> butterworthFilter(const QVector<double> &x, double cutoffHz, double fs)
+{
+    return IIRFilter::butterworth(2, FilterType::LowPass, fs, cutoffHz).apply(x);
+}
+
+IIRFilter envelopeLowpass(int order, double cutoffHz, double fs)
+{
+    return IIRFilter::butterworth(order, FilterType::LowPass, fs, cutoffHz);
+}
+
+
+void LiveMBNProcessor::reset(int rows, int cols, double fs, double cutoffHz)
+{
+    averager.reset(rows, cols);
+    mbn.clear();
+    mbn.reserve(std::max(0, rows));
+    env.clear();
+    env.reserve(std::max(0, rows));
+    sumAbs = sumSq = 0.0;
+
+    lowpass = StreamingIIRFilter(envelopeLowpass(2, cutoffHz, fs));
+}
+
+int LiveMBNProcessor::append(const double *samples, int count)
+{
+    if (!averager.add(samples, count))
+        return -1;
+
+    const int from = mbn.size();
+    const int to = averager.completedRows();
+    if (to == from)
+        return 0;
+
+    mbn.resize(to);
+    env.resize(to);
+    for (int i = from; i < to; ++i) {
+        const double v = averager.average(i);
+        mbn[i] = v;
+        sumAbs += std::abs(v);
+        sumSq  += v * v;
+        env[i] = 2.0 * v * v;
+    }
+
+    // Same steps as extractEnvelopes; the filter state carries over between calls
+    double *e = env.data() + from;
+    lowpass.process(e, e, to - from);
+    envelopeRoot(e, to - from);
+    return to - from;
+}
+
+void LiveMBNProcessor::provisionalStats(double &meanAbs, double &rms) const
+{
+    const int n = provisionalCount();
+    double a = sumAbs, s = sumSq;
+    for (int i = mbn.size(); i < n; ++i) {
+        const double v = averager.runningAverage(i);
+        a += std::abs(v);
+        s += v * v;
+    }
+    meanAbs = n > 0 ? a / n : 0.0;
+    rms = n > 0 ? std::sqrt(s / n) : 0.0;
+}
+
+MBNMatrix extractEnvelopes(const MBNMatrix &mbnMatrix, EnvelopeMode mode)
+{
+    const double Fs = 10000.0;      // envelope sampling frequency (1 kHz)
+    const double cutoffHz = 20.0;   // low-pass cutoff frequency 2 Hz
+
+    return extractEnvelopes(mbnMatrix, envelopeLowpass(2, cutoffHz, Fs), mode);
+}
+
+MBNMatrix extractEnvelopes(const MBNMatrix &mbnMatrix, const IIRFilter &lowpass, EnvelopeMode mode)
+{
+    MBNMatrix filterMBN;
+
+    // Causal: square, low-pass and square root fused into one pass per block
+    if (mode == EnvelopeMode::Causal) {
+        envelopesInto(lowpass, mbnMatrix, filterMBN);
+        return filterMBN;
+    }
+
+    // Zero-phase needs the whole squared signal before the backward pass, so the steps
+    // run one after the other on a single buffer per signal
+    filterMBN.reserve(mbnMatrix.size());
+    for (const DoubleVector &x1 : mbnMatrix) {
+        const int N = x1.size();
+        QVector<double> env(N);
+
+        // Step 1: square detection (with factor 2)
+        for (int j = 0; j < N; ++j)
+            env[j] = 2.0 * x1[j] * x1[j];
+
+        // Step 2: forward and backward low-pass, in place
+        lowpass.applyZeroPhase(env.data(), N);
+
+        // Step 3: square root recovery (multiply by 2 again)
+        envelopeRoot(env.data(), N);
+
+        filterMBN << env;  // append to output matrix
+    }
+
+    return filterMBN;
+}
+
+int maxEnvelopeDecimation(double fs, double cutoffHz)
+{
+    if (!(fs > 0.0) || !(cutoffHz > 0.0))
+        return 1;
+    return int(std::clamp(std::floor(fs / (2.0 * cutoffHz * kDecimationMargin)), 1.0, double(std::numeric_limits<int>::max())));
+}
+
+EnvelopeMatrix extractEnvelopesMultirate(const MBNMatrix &mbnMatrix, double fs, int decimation,
+                                         EnvelopeMode mode, double cutoffHz)
+{
+    const int maxDecimation = maxEnvelopeDecimation(fs, cutoffHz);
+    if (decimation > maxDecimation) {
+        qWarning() << "Decimation" << decimation << "is too high for" << cutoffHz << "Hz at" << fs
+                   << "Hz - using" << maxDecimation;
+        decimation = maxDecimation;
+    }
+    const FIRDecimator decimator(decimation);
+    EnvelopeMatrix result;
+    result.fs = fs / decimator.factor();
+    const IIRFilter lowpass = envelopeLowpass(2, cutoffHz, result.fs);
+
+    result.samples.reserve(mbnMatrix.size());
+    DoubleVector x2;   // squared signal, reused across signals
+    for (const DoubleVector &x1 : mbnMatrix) {
+        const int N = x1.size();
+
+        // Step 1: square detection (with factor 2)
+        x2.resize(N);
+        for (int j = 0; j < N; ++j)
+            x2[j] = 2.0 * x1[j] * x1[j];
+
+        // Step 2: anti-aliased decimation, then the low-pass at the reduced rate
+        DoubleVector env(decimator.outputLength(N));
+        decimator.decimate(x2.constData(), N, env.data());
+        if (mode == EnvelopeMode::ZeroPhase)
+            lowpass.applyZeroPhase(env.data(), env.size());
+        else
+            lowpass.apply(env.constData(), env.data(), env.size());
+
+        // Step 3: square root recovery (multiply by 2 again)
+        envelopeRoot(env.data(), env.size());
+        result.samples << env;
+    }
+    return result;
+}
+
+// Turns an nfft-point spectrum into that of the analytic signal, as scipy.signal.hilbert:
+// DC (and Nyquist for even nfft) kept, positive frequencies doubled, negative ones
+// zeroed. The 1/nfft that kiss_fft leaves out of the inverse transform is folded in.
+static void toAnalyticSpectrum(kiss_fft_cpx *X, int nfft)
+{
+    const kiss_fft_scalar one = kiss_fft_scalar(1.0 / nfft);
+    const kiss_fft_scalar two = kiss_fft_scalar(2.0 / nfft);
+    const int positiveEnd = (nfft + 1) / 2;   // first bin past the positive frequencies
+    X[0].r *= one;
+    X[0].i *= one;
+    for (int k = 1; k < positiveEnd; ++k) {
+        X[k].r *= two;
+        X[k].i *= two;
+    }
+    if (nfft % 2 == 0) {
+        X[nfft / 2].r *= one;
+        X[nfft / 2].i *= one;
+    }
+    for (int k = nfft / 2 + 1; k < nfft; ++k)
+        X[k].r = X[k].i = 0;
+}
+
+static void magnitudeSquared(const kiss_fft_cpx *z, double *power, int n)
+{
+    for (int j = 0; j < n; ++j)
+        power[j] = double(z[j].r) * z[j].r + double(z[j].i) * z[j].i;
+}
+
+// |analytic signal of x|^2 of n samples, through zero-padded nfft-point transforms
+static void analyticPower(const double *x, int n, int nfft,
+                          std::vector<kiss_fft_cpx> &z, std::vector<kiss_fft_cpx> &Z, double *power)
+{
+    for (int j = 0; j < n; ++j) {
+        z[j].r = kiss_fft_scalar(x[j]);
+        z[j].i = 0;
+    }
+    for (int j = n; j < nfft; ++j)
+        z[j].r = z[j].i = 0;
+
+    kiss_fft(fftPlan(nfft, false), z.data(), Z.data());
+    toAnalyticSpectrum(Z.data(), nfft);
+    kiss_fft(fftPlan(nfft, true), Z.data(), z.data());
+    magnitudeSquared(z.data(), power, n);
+}
+
+// Same for two real signals at once: a + ib goes through one forward transform and the
+// two spectra are separated by conjugate symmetry, A[k] = (Z[k] + conj Z[-k]) / 2 and
+// B[k] = (Z[k] - conj Z[-k]) / 2i; only the bins kept by toAnalyticSpectrum are formed
+static void analyticPowerPair(const double *a, const double *b, int n, int nfft,
+                              std::vector<kiss_fft_cpx> &z, std::vector<kiss_fft_cpx> &Z,
+                              std::vector<kiss_fft_cpx> &w, double *powerA, double *powerB)
+{
+    for (int j = 0; j < n; ++j) {
+        z[j].r = kiss_fft_scalar(a[j]);
+        z[j].i = kiss_fft_scalar(b[j]);
+    }
+    for (int j = n; j < nfft; ++j)
+        z[j].r = z[j].i = 0;
+
+    kiss_fft(fftPlan(nfft, false), z.data(), Z.data());
+    for (int k = 0; k <= nfft / 2; ++k) {
+        const kiss_fft_cpx p = Z[k], q = Z[k == 0 ? 0 : nfft - k];
+        z[k].r = (p.r + q.r) / 2;
+        z[k].i = (p.i - q.i) / 2;
+        w[k].r = (p.i + q.i) / 2;
+        w[k].i = (q.r - p.r) / 2;
+    }
+    toAnalyticSpectrum(z.data(), nfft);
+    toAnalyticSpectrum(w.data(), nfft);
+
+    kiss_fft_cfg inverse = fftPlan(nfft, true);
+    kiss_fft(inverse, z.data(), Z.data());
+    magnitudeSquared(Z.data(), powerA, n);
+    kiss_fft(inverse, w.data(), Z.data());
+    magnitudeSquared(Z.data(), powerB, n);
+}
+
+MBNMatrix extractEnvelopesHilbert(const MBNMatrix &mbnMatrix, double fs, double smoothingHz)
+{
+    IIRFilter smoothing;
+    if (smoothingHz > 0.0)
+        smoothing = envelopeLowpass(2, smoothingHz, fs);
+
+    const int count = mbnMatrix.size();
+    MBNMatrix envelopes(count);
+    std::vector<kiss_fft_cpx> z, Z, w;   // transform buffers, reused across signals
+    for (int i = 0; i < count;) {
+        const int n = mbnMatrix[i].size();
+        const int nfft = fftFastSize(n);
+        z.resize(nfft);
+        Z.resize(nfft);
+        envelopes[i].resize(n);
+        if (n > 0 && i + 1 < count && mbnMatrix[i + 1].size() == n) {
+            w.resize(nfft);
+            envelopes[i + 1].resize(n);
+            analyticPowerPair(mbnMatrix[i].constData(), mbnMatrix[i + 1].constData(), n, nfft,
+                              z, Z, w, envelopes[i].data(), envelopes[i + 1].data());
+            i += 2;
+        } else {
+            if (n > 0)
+                analyticPower(mbnMatrix[i].constData(), n, nfft, z, Z, envelopes[i].data());
+            ++i;
+        }
+    }
+
+    for (DoubleVector &env : envelopes) {
+        if (smoothing.isValid())
+            smoothing.applyZeroPhase(env.data(), env.size());
+        envelopeRoot(env.data(), env.size());   // 2*sqrt(power) = 2*|analytic signal|
+    }
+    return envelopes;
+}
+
+MBNMatrix extractEnvelopesRMS(const MBNMatrix &mbnMatrix, double fs, double cutoffHz)
+{
+    // An N-point moving average is 3 dB down at about 0.443*fs/N
+    const int half = cutoffHz > 0.0 ? std::max(0, int(std::lround(0.443 * fs / cutoffHz)) / 2) : 0;
+    const int window = 2 * half + 1;
+
+    MBNMatrix envelopes;
+    envelopes.reserve(mbnMatrix.size());
+    DoubleVector mean;   // unused by-product of slidingMoments, reused across signals
+    for (const DoubleVector &x1 : mbnMatrix) {
+        const int N = x1.size();
+        DoubleVector env(N);
+        mean.resize(N);
+        slidingMoments(x1.constData(), N, window, WindowAlignment::Centred, mean.data(), env.data());
+        for (double &v : env)
+            v *= 2.0;
+        envelopeRoot(env.data(), N);   // 2*sqrt(mean of 2*x^2)
+        envelopes << env;
+    }
+    return envelopes;
+}
+
+MBNMatrix extractEnvelopesPeakHold(const MBNMatrix &mbnMatrix, double fs, double cutoffHz)
+{
+    const double decay = cutoffHz > 0.0 ? std::exp(-2.0 * M_PI * cutoffHz / fs) : 0.0;
+
+    MBNMatrix envelopes;
+    envelopes.reserve(mbnMatrix.size());
+    for (const DoubleVector &x1 : mbnMatrix) {
+        const int N = x1.size();
+        DoubleVector env(N);
+        double held = 0.0;
+        for (int j = 0; j < N; ++j) {
+            held = std::max(2.0 * std::abs(x1[j]), held * decay);
+            env[j] = held;
+        }
+        envelopes << env;
+    }
+    return envelopes;
+}
+
+// Samples per signal taken through the fused envelope kernels at a time (4 KB per signal,
+// 32 KB for a full set of lanes)
+static const int kEnvelopeBlock = 512;
+
+void envelopeInto(const IIRFilter &lowpass, const double *mbn, double *env, int n)
+{
+    QVarLengthArray<double, 32> state(lowpass.stateSize());
+    std::fill(state.begin(), state.end(), 0.0);
+
+    // Each block of env is squared into, filtered and rooted while it is still in L1
+    for (int begin = 0; begin < n; begin += kEnvelopeBlock) {
+        const int len = std::min(kEnvelopeBlock, n - begin);
+        const double *x = mbn + begin;
+        double *e = env + begin;
+        for (int i = 0; i < len; ++i)
+            e[i] = 2.0 * x[i] * x[i];
+        lowpass.filter(e, e, len, state.data());
+        envelopeRoot(e, len);
+    }
+}
+
+void envelopesInto(const IIRFilter &lowpass, const MBNMatrix &mbn, MBNMatrix &env)
+{
+    env.resize(mbn.size());
+    for (int s = 0; s < mbn.size(); ++s)
+        env[s].resize(mbn[s].size());
+
+    const QVector<double> coeffs = lowpass.packedCoefficients();
+    const int sections = lowpass.sections().size();
+    QVector<double> tile(kEnvelopeBlock * kBiquadLanes);
+    QVector<double> state(2 * kBiquadLanes * sections);
+    const double *in[kBiquadLanes];
+    double *out[kBiquadLanes];
+
+    for (int first = 0; first < mbn.size();) {
+        // Next run of up to kBiquadLanes signals of the same length
+        const int n = mbn[first].size();
+        int count = 1;
+        while (count < kBiquadLanes && first + count < mbn.size() && mbn[first + count].size() == n)
+            ++count;
+
+        if (count == 1) {
+            envelopeInto(lowpass, mbn[first].constData(), env[first].data(), n);
+            ++first;
+            continue;
+        }
+
+        // Unused lanes filter zeros and are never copied out
+        for (int l = 0; l < count; ++l) {
+            in[l] = mbn[first + l].constData();
+            out[l] = env[first + l].data();
+        }
+        tile.fill(0.0);
+        state.fill(0.0);
+
+        // Squared on the way into the interleaved tile, rooted in the tile before copying out
+        double *t = tile.data();
+        for (int begin = 0; begin < n; begin += kEnvelopeBlock) {
+            const int len = std::min(kEnvelopeBlock, n - begin);
+            for (int i = 0; i < len; ++i) {
+                double *row = t + i * kBiquadLanes;
+                for (int l = 0; l < count; ++l) {
+                    const double x = in[l][begin + i];
+                    row[l] = 2.0 * x * x;
+                }
+            }
+
+            biquadCascadeLanes(coeffs.constData(), sections, t, len, state.data());
+            envelopeRoot(t, len * kBiquadLanes);
+
+            for (int i = 0; i < len; ++i) {
+                const double *row = t + i * kBiquadLanes;
+                for (int l = 0; l < count; ++l)
+                    out[l][begin + i] = row[l];
+            }
+        }
+        first += count;
+    }
+}
+
+
+// —————————————— New peak and ringing functions ——————————————
+
+QVector<double> peakProminences(const QVector<double> &sig)
+{
+    // prominence(i) = sig[i] - max(minLeft, minRight), where minLeft is the minimum of
+    // sig[i] and the run of samples below it directly to its left, and minRight likewise.
+    // Each run ends at the nearest sample >= sig[i], found with a stack of samples whose
+    // values do not increase. Every entry also carries the minimum from just after the
+    // entry below it up to itself, so the minimum of a run is collected from the entries
+    // popped while looking for its end. O(N) in total.
+    struct Entry {
+        double value;
+        double runMin;
+    };
+    const int N = sig.size();
+    const double *x = sig.constData();
+    QVector<double> prominence(N);
+    QVector<Entry> stackBuffer(N);
+    Entry *stack = stackBuffer.data();
+
+    // Left runs; their minima are parked in prominence[] until the right pass
+    int top = 0;
+    for (int i = 0; i < N; ++i) {
+        double runMin = x[i];
+        while (top > 0 && stack[top - 1].value < x[i])
+            runMin = std::min(runMin, stack[--top].runMin);
+        stack[top++] = { x[i], runMin };
+        prominence[i] = runMin;
+    }
+
+    top = 0;
+    for (int i = N - 1; i >= 0; --i) {
+        double runMin = x[i];
+        while (top > 0 && stack[top - 1].value < x[i])
+            runMin = std::min(runMin, stack[--top].runMin);
+        stack[top++] = { x[i], runMin };
+        prominence[i] = x[i] - std::max(prominence[i], runMin);
+    }
+    return prominence;
+}
+
+// For every query index q (ascending), the last index <= q whose sample is not above
+// level[q] (<= it, or NaN, where the scan `while (x[L] > half)` also stops), or -1.
+// Indices of the suffix minima of sig[0..i] form a stack with increasing values, and the
+// answer is the topmost entry at or below the level: a binary search per query. NaN is
+// ranked as -inf, below every level.
+static QVector<int> lastAtOrBelow(const QVector<double> &sig, const QVector<int> &queries,
+                                  const QVector<double> &levels)
+{
+    auto rank = [&sig](int k) {
+        return std::isnan(sig[k]) ? -std::numeric_limits<double>::infinity() : sig[k];
+    };
+    QVector<int> answers(queries.size(), -1);
+    QVector<int> stack;
+    int next = 0;
+    for (int i = 0; i < sig.size() && next < queries.size(); ++i) {
+        while (!stack.isEmpty() && rank(stack.last()) >= rank(i))
+            stack.removeLast();
+        stack.append(i);
+        for (; next < queries.size() && queries[next] == i; ++next) {
+            // First stack entry above the level; the one before it is the answer
+            const auto above = std::upper_bound(stack.constBegin(), stack.constEnd(), levels[next],
+                                                [&rank](double level, int k) { return level < rank(k); });
+            if (above != stack.constBegin())
+                answers[next] = *(above - 1);
+        }
+    }
+    return answers;
+}
+
+// Peaks are first resolved by short scans, like the original search; a scan that would
+// run further than this many samples is settled by the whole-signal passes instead
+// (peakProminences, lastAtOrBelow), which run at most once each. Typical peaks stay as
+// cheap as before and no input can make the search quadratic.
+static const int kPeakScanLimit = 64;
+
+// Whether one side of x[i] reaches `threshold` below it: 1 or 0, or -1 if the scan gives up
+// after kPeakScanLimit samples. The side is the run of samples lower than x[i] in the
+// direction `step`, and it qualifies if one of them (or x[i] itself, for an empty run) is
+// low enough; the prominence is at least the threshold exactly when both sides qualify.
+static int reachesBelow(const double *x, int n, int i, int step, double threshold)
+{
+    const double peak = x[i];
+    if (peak - peak >= threshold)
+        return 1;
+    for (int j = i + step; j >= 0 && j < n && x[j] < peak; j += step) {
+        if (peak - x[j] >= threshold)
+            return 1;
+        if (std::abs(j - i) >= kPeakScanLimit)
+            return -1;
+    }
+    return 0;
+}
+
+// Amplitude, FWHM and ratio of the peaks at the given (ascending) sample indices.
+// Half-maximum crossings: the nearest sample at or below half the peak on each side, or
+// the end of the signal. Peaks with a crossing too far away for a short scan wait in
+// `pending` (-1 for the unknown side) for lastAtOrBelow.
+static QVector<PeakInfo> peakWidths(const QVector<double> &signal, double fs,
+                                    const QVector<int> &positions)
+{
+    QVector<PeakInfo> peaks;
+    peaks.reserve(positions.size());
+    const int N = signal.size();
+    const double *x = signal.constData();
+
+    struct Pending {
+        int peak;    // index into peaks
+        int at;      // sample index
+        int L, R;
+    };
+    QVector<Pending> pending;
+    for (int i : positions) {
+        const double half = x[i] / 2.0;
+        int L = i;
+        while (L > 0 && x[L] > half && i - L < kPeakScanLimit) --L;
+        if (L > 0 && x[L] > half)
+            L = -1;
+        int R = i;   // a peak at the last sample has no right side
+        while (R < N - 1 && i < N - 1 && x[R] > half && R - i < kPeakScanLimit) ++R;
+        if (R < N - 1 && x[R] > half)
+            R = -1;
+
+        if (L < 0 || R < 0)
+            pending.append({ int(peaks.size()), i, L, R });
+        double widthSec = double(R - L) / fs;
+        peaks.append({ x[i], widthSec, x[i] / widthSec });
+    }
+    if (pending.isEmpty())
+        return peaks;
+
+    // Far crossings on the left, then on the right through the mirrored signal (where the
+    // queries come in reverse order)
+    QVector<int> at;
+    QVector<double> levels;
+    QVector<int> which;
+    for (int q = 0; q < pending.size(); ++q) {
+        if (pending[q].L < 0) {
+            which << q;
+            at << pending[q].at;
+            levels << x[pending[q].at] / 2.0;
+        }
+    }
+    if (!which.isEmpty()) {
+        const QVector<int> crossing = lastAtOrBelow(signal, at, levels);
+        for (int k = 0; k < which.size(); ++k)
+            pending[which[k]].L = std::max(0, crossing[k]);
+    }
+
+    which.clear();
+    at.clear();
+    levels.clear();
+    for (int q = pending.size() - 1; q >= 0; --q) {
+        if (pending[q].R < 0) {
+            which << q;
+            at << N - 1 - pending[q].at;
+            levels << x[pending[q].at] / 2.0;
+        }
+    }
+    if (!which.isEmpty()) {
+        QVector<double> reversed(N);
+        std::reverse_copy(signal.constBegin(), signal.constEnd(), reversed.begin());
+        const QVector<int> crossing = lastAtOrBelow(reversed, at, levels);
+        for (int k = 0; k < which.size(); ++k)
+            pending[which[k]].R = crossing[k] < 0 ? N - 1 : N - 1 - crossing[k];
+    }
+
+    for (const Pending &p : pending) {
+        double widthSec = double(p.R - p.L) / fs;
+        peaks[p.peak] = { x[p.at], widthSec, x[p.at] / widthSec };
+    }
+
+    return peaks;
+}
+
+// Prominence test of findPeaksWithWidth: short scans first, which stop as soon as a side
+// is settled, and the whole-signal pass (kept in `all`) for the rest
+static bool isProminent(const QVector<double> &signal, int i, double threshold,
+                        QVector<double> &all)
+{
+    const double *x = signal.constData();
+    const int left = reachesBelow(x, signal.size(), i, -1, threshold);
+    if (left == 0)
+        return false;
+    const int right = reachesBelow(x, signal.size(), i, 1, threshold);
+    if (right == 0)
+        return false;
+    if (left > 0 && right > 0)
+        return true;
+    if (all.isEmpty())
+        all = peakProminences(signal);
+    return all[i] >= threshold;
+}
+
+QVector<PeakInfo> findPeaksWithWidth(const QVector<double> &signal, double fs, double minProminenceRatio)
+{
+    int N = signal.size();
+    if (N < 3) return {};
+    const double *x = signal.constData();
+
+    double globalMax = *std::max_element(signal.constBegin(), signal.constEnd());
+    double promThresh = globalMax * minProminenceRatio;
+
+    // Local maxima (and a rising last point) that are prominent enough. Only strict
+    // maxima are candidates, so a flat top yields no peak.
+    QVector<double> prominences;   // all of them, computed on the first long scan
+    QVector<int> candidates(N / 2 + 2);
+    const int candidateCount = localMaxima(x, N, -std::numeric_limits<double>::infinity(),
+                                           candidates.data());
+    QVector<int> positions;
+    for (int c = 0; c < candidateCount; ++c) {
+        if (isProminent(signal, candidates[c], promThresh, prominences))
+            positions << candidates[c];
+    }
+    if (x[N - 1] > x[N - 2] && isProminent(signal, N - 1, promThresh, prominences))
+        positions << N - 1;
+
+    return peakWidths(signal, fs, positions);
+}
+
+QVector<PeakInfo> findTopPeaksWithWidth(const QVector<double> &signal, double fs,
+                                        double minProminenceRatio, int k)
+{
+    if (k <= 0)
+        return findPeaksWithWidth(signal, fs, minProminenceRatio);
+    int N = signal.size();
+    if (N < 3) return {};
+    const double *x = signal.constData();
+
+    double globalMax = *std::max_element(signal.constBegin(), signal.constEnd());
+    double promThresh = globalMax * minProminenceRatio;
+
+    // The K best peaks so far in a min-heap, worst on top: lower amplitude, or the same
+    // amplitude further right. Candidates come in ascending order, so one no higher than
+    // the worst kept peak cannot get in and is skipped before its prominence is computed.
+    auto better = [x](int a, int b) { return x[a] > x[b] || (x[a] == x[b] && a < b); };
+    QVector<int> heap;
+    QVector<double> prominences;
+    auto consider = [&](int i) {
+        if (heap.size() == k && !(x[i] > x[heap.first()]))
+            return;
+        if (!isProminent(signal, i, promThresh, prominences))
+            return;
+        heap << i;
+        std::push_heap(heap.begin(), heap.end(), better);
+        if (heap.size() > k) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.removeLast();
+        }
+    };
+
+    QVector<int> candidates(N / 2 + 2);
+    const int candidateCount = localMaxima(x, N, -std::numeric_limits<double>::infinity(),
+                                           candidates.data());
+    // At most the candidates and the last point can enter, whatever k the caller asks for
+    heap.reserve(std::min(k, candidateCount + 1) + 1);
+    for (int c = 0; c < candidateCount; ++c)
+        consider(candidates[c]);
+    if (x[N - 1] > x[N - 2])
+        consider(N - 1);
+
+    // Widths of the survivors only, then highest first
+    std::sort(heap.begin(), heap.end());
+    const QVector<PeakInfo> widths = peakWidths(signal, fs, heap);
+    QVector<int> order(heap.size());
+    for (int j = 0; j < order.size(); ++j)
+        order[j] = j;
+    std::sort(order.begin(), order.end(),
+              [&](int a, int b) { return better(heap[a], heap[b]); });
+    QVector<PeakInfo> peaks;
+    peaks.reserve(order.size());
+    for (int j : order)
+        peaks << widths[j];
+    return peaks;
+}
+
+int countRingingByPeaks(const QVector<double> &x, double thresholdRatio = 0.01)
+{
+    // Compute amplitude threshold epsVal = thresholdRatio * max(|x|)
+    double maxAbs = 0.0;
+    for (double v : x) {
+        maxAbs = std::max(maxAbs, std::abs(v));
+    }
+    return countRingingAbove(x.constData(), x.size(), thresholdRatio * maxAbs);
+}
+
+int countRingingAbove(const double *x, int N, double epsVal)
+{
+    if (N < 2) return 0;
+
+    int posCount = 0, negCount = 0;
+
+    // Start point i=0
+    if (x[0] > x[1] && x[0] > epsVal) ++posCount;
+    if (-x[0] > -x[1] && -x[0] > epsVal) ++negCount;
+
+    // Interior i=1..N-2: strict positive and negative peaks. A flat region is never a
+    // strict peak, so it cannot be counted twice.
+    int interiorPos = 0, interiorNeg = 0;
+    countLocalExtrema(x, N, epsVal, interiorPos, interiorNeg);
+    posCount += interiorPos;
+    negCount += interiorNeg;
+
+    // End point i=N-1
+    if (x[N - 1] > x[N - 2] && x[N - 1] > epsVal) ++posCount;
+    if (-x[N - 1] > -x[N - 2] && -x[N - 1] > epsVal) ++negCount;
+
+    // One ringing ≈ one positive peak + one negative peak, round up
+    int totalPeaks = posCount + negCount;
+    return static_cast<int>(std::ceil(totalPeaks / 2.0));
+}
+void analyzeAllPeaks(const MBNMatrix &envelopes,
+                     double fs, double minProminenceRatio, double ringingThresholdRatio)
+{
+    for (int idx = 0; idx < envelopes.size(); ++idx) {
+        const DoubleVector &env = envelopes[idx];
+
+        // 1) Peak detection (amplitude, FWHM (s), amplitude-to-width ratio)
+        QVector<PeakInfo> peaks = findPeaksWithWidth(env, fs, minProminenceRatio);
+
+        // 2) Ringing count
+        int ringing = countRingingByPeaks(env, ringingThresholdRatio);
+
+        // 3) Print
+        qDebug().noquote() << QString("=== Signal %1 Peak Features ===").arg(idx + 1);
+        qDebug().noquote() << QString("Ringing Count = %1").arg(ringing);
+
+        for (int j = 0; j < peaks.size(); ++j) {
+            const PeakInfo &p = peaks[j];
+            qDebug().noquote()
+                << QString("Peak %1: Amplitude=%2, FWHM=%3 s, Ratio=%4")
+                       .arg(j + 1)
+                       .arg(p.amplitude, 0, 'f', 6)
+                       .arg(p.fwhm,      0, 'f', 6)
+                       .arg(p.ratio,     0, 'f', 6);
+        }
+    }
+}
+
+TimeDomainFeatures timeDomainFeatures(const double *x, int n)
+{
+    TimeDomainFeatures t;
+    if (n <= 0) return t;
+
+    const double shift = x[0];
+    const MomentSums s = momentSums(x, n, shift);
+    const double m1 = s.sum / n, s2 = s.sumSq / n, s3 = s.sumCube / n, s4 = s.sumQuad / n;
+
+    t.count = n;
+    t.mean = shift + m1;
+    t.meanAbs = s.sumAbs / n;
+    t.min = s.min;
+    t.max = s.max;
+    t.peak = std::max(std::abs(s.min), std::abs(s.max));
+    t.variance = std::max(0.0, s2 - m1 * m1);
+    t.rms = std::sqrt(t.variance + t.mean * t.mean);
+    if (t.rms > 0.0)
+        t.crestFactor = t.peak / t.rms;
+    if (t.variance > 0.0) {
+        const double m3 = s3 - 3.0 * m1 * s2 + 2.0 * m1 * m1 * m1;
+        const double m4 = s4 - 4.0 * m1 * s3 + 6.0 * m1 * m1 * s2 - 3.0 * m1 * m1 * m1 * m1;
+        t.skewness = m3 / (t.variance * std::sqrt(t.variance));
+        t.kurtosis = std::max(0.0, m4) / (t.variance * t.variance);
+    }
+    return t;
+}
+
+TimeDomainFeatures timeDomainFeatures(const DoubleVector &x)
+{
+    return timeDomainFeatures(x.constData(), x.size());
+}
+
+SignalFeatures computeSignalFeatures(const DoubleVector &mbn, const DoubleVector &envelope, double fs,
+                                     int maxPeaks)
+{
+    SignalFeatures f;
+    const int N = mbn.size();
+    if (N == 0) return f;
+
+    // 1. Mean & RMS
+    const TimeDomainFeatures t = timeDomainFeatures(mbn.constData(), N);
+    f.meanAbs = t.meanAbs;
+    f.rms     = t.rms;
+
+    // 2. Ringing count, above 2% of the peak found in the same sweep. Long captures are
+    // searched on all cores (same results).
+    if (N >= kParallelPeakMinSamples)
+        f.ringing = countRingingAboveParallel(mbn.constData(), N, 0.02 * t.peak);
+    else
+        f.ringing = countRingingAbove(mbn.constData(), N, 0.02 * t.peak);
+
+    // 3. Envelope peak features (FWHM, ratio, etc.). The parallel search finds them all;
+    // its top K are the first K after a stable sort by amplitude.
+    if (envelope.size() >= kParallelPeakMinSamples) {
+        f.peaks = findPeaksWithWidthParallel(envelope, fs, 0.2);
+        if (maxPeaks > 0) {
+            std::stable_sort(f.peaks.begin(), f.peaks.end(), [](const PeakInfo &a, const PeakInfo &b) {
+                return a.amplitude > b.amplitude;
+            });
+            if (f.peaks.size() > maxPeaks)
+                f.peaks.resize(maxPeaks);
+        }
+    } else if (!envelope.isEmpty()) {
+        f.peaks = findTopPeaksWithWidth(envelope, fs, 0.2, maxPeaks);
+    }
+
+    return f;
+}
@@ -1,34 +1,235 @@
-#pragma once
-#include <QVector>
-#include <QList>
-#include <QVariant>
-#include <cmath>
-
-using DoubleVector = QVector<double>;
-using MBNMatrix = QVector<DoubleVector>;
-using TableData = QList<QList<QVariant>>;
-using RowData = QList<QVariant>;
-
-struct PeakInfo {
-    double amplitude;
-    double fwhm;
-    double ratio;
-};
-
-MBNMatrix processAllMBN(const QList<TableData> &allData);
-MBNMatrix extractEnvelopes(const MBNMatrix &mbnMatrix);
-// 打印每路包络的峰值特征（幅值、FWHM、幅宽比）及振铃次数
-void analyzeAllPeaks(const MBNMatrix &envelopes,
-                     double fs = 100000.0,
-                     double minProminenceRatio = 0.2,
-                     double ringingThresholdRatio = 0.01);
-QVector<double> butterworthFilter(const QVector<double> &x, double cutoffHz, double fs);
-
-
-// 下面两个要用 QVector<double> 和你 MainWindow 里传的一致
-QVector<PeakInfo> findPeaksWithWidth(const QVector<double> &signal,
-                                    double fs,
-                                    double minProminenceRatio);
-int countRingingByPeaks(const QVector<double> &x,
-                          double thresholdRatio);
-
+#pragma once
+#include <QVector>
+#include <QList>
+#include <QVariant>
+#include <algorithm>
+#include <cmath>
+#include "dbloader.h"
+#include "iirfilter.h"
+
+using DoubleVector = QVector<double>;
+using MBNMatrix = QVector<DoubleVector>;
+using TableData = QList<QList<QVariant>>;
+using RowData = QList<QVariant>;
+
+struct PeakInfo {
+    double amplitude;
+    double fwhm;
+    double ratio;
+};
+
+// Amplitude statistics of one signal, all from a single sweep over the samples
+struct TimeDomainFeatures {
+    int count = 0;
+    double mean = 0.0;
+    double meanAbs = 0.0;      // mean of |x|
+    double rms = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double peak = 0.0;         // max |x|
+    double crestFactor = 0.0;  // peak / rms, 0 for an all-zero signal
+    double variance = 0.0;     // population variance
+    double skewness = 0.0;     // m3 / m2^1.5, 0 for a constant signal
+    double kurtosis = 0.0;     // m4 / m2^2 (3 for a Gaussian), 0 for a constant signal
+};
+
+// One momentSums pass (see simdkernels.h) about x[0], so a signal with a large offset
+// keeps its precision; the central moments are derived from the power sums
+TimeDomainFeatures timeDomainFeatures(const double *x, int n);
+TimeDomainFeatures timeDomainFeatures(const DoubleVector &x);
+
+// Per-signal results shown in the log (and stored in the signal cache)
+struct SignalFeatures {
+    double meanAbs = 0.0;     // mean of |x|
+    double rms = 0.0;
+    int ringing = 0;
+    QVector<PeakInfo> peaks;  // envelope peaks
+};
+
+MBNMatrix processAllMBN(const QList<TableData> &allData);
+MBNMatrix processAllMBN(const DBColumnData &allData);
+
+// Incremental form of the processAllMBN channel average. Samples are pushed in file order
+// (channel-major); sample k is summed into row k % rows, so the output is bit-identical
+// to the batch average while only the rows-sized sum buffer is kept.
+class ChannelAverager {
+public:
+    ChannelAverager() = default;
+    ChannelAverager(int rows, int cols);
+    void reset(int rows, int cols);
+
+    // Returns false if more than rows*cols samples are pushed
+    bool add(const double *samples, int count);
+    qint64 received() const { return receivedCount; }
+    qint64 expected() const { return qint64(rows) * cols; }
+    // Rows whose last channel has arrived; their average no longer changes
+    int completedRows() const;
+    double average(int row) const { return sums[row] / cols; }
+    // Rows that at least one channel has reached, and their mean over the channels received
+    // so far (the same value as average() once the row is complete)
+    int coveredRows() const { return int(std::min<qint64>(receivedCount, rows)); }
+    double runningAverage(int row) const;
+    // Divides the sums by cols; false (and a warning) if the stream had the wrong size
+    bool result(DoubleVector &MBN) const;
+
+private:
+    int rows = 0;
+    int cols = 0;
+    qint64 receivedCount = 0;
+    DoubleVector sums;
+};
+
+// Streaming load + average of one file: chunks are read on a reader thread and averaged
+// here while the next chunk is fetched. Peak memory is a few chunks plus the output.
+// progress, if set, is called after every chunk; returning false cancels the load.
+using StreamProgress = std::function<bool(qint64 received, qint64 total)>;
+// layout, if set, receives the discovered capture layout (e.g. its sample rate).
+bool processMBNStreaming(const QString &dbFile, DoubleVector &MBN, int chunkRows = 16384,
+                         const StreamProgress &progress = StreamProgress(),
+                         CaptureLayout *layout = nullptr);
+
+// extractEnvelopes designs its 20 Hz low-pass for a 10 kHz rate, so on the rigs' 100 kHz
+// captures the envelope bandwidth is really 200 Hz. The detectors that work at the
+// true rate use this bandwidth by default, so switching to them keeps the envelope shape.
+const double kEnvelopeCutoffHz = 200.0;
+
+// Follow-mode counterpart of processAllMBN + the square-law envelope for one capture that
+// is still being written. Raw samples are appended in file order; each averaged sample is
+// final once its last channel has arrived, and only those new samples are run through the
+// envelope filter (whose state is carried between calls) and the running mean/RMS sums.
+// Results are bit-identical to the batch path over the same samples (the causal
+// "square-law" method of envelopemethods.h at the same fs and cut-off).
+class LiveMBNProcessor {
+public:
+    LiveMBNProcessor() = default;
+    void reset(int rows, int cols, double fs = kDefaultMBNSampleRate, double cutoffHz = kEnvelopeCutoffHz);
+
+    // Returns the number of averaged samples finalized by this call, or -1 once more than
+    // rows*cols samples have been appended
+    int append(const double *samples, int count);
+
+    const DoubleVector &average() const { return mbn; }
+    const DoubleVector &envelope() const { return env; }
+    int finalizedCount() const { return mbn.size(); }
+    bool isComplete() const { return averager.expected() > 0 && averager.received() == averager.expected(); }
+    double meanAbs() const { return mbn.isEmpty() ? 0.0 : sumAbs / mbn.size(); }
+    double rms() const { return mbn.isEmpty() ? 0.0 : std::sqrt(sumSq / mbn.size()); }
+
+    // Samples are channel-major, so nothing is final until the last channel block starts
+    // arriving. Until then the rows reached so far can be shown as a running average over
+    // the channels received; finalized rows keep their exact value.
+    int provisionalCount() const { return averager.coveredRows(); }
+    double provisionalAverage(int row) const
+    {
+        return row < mbn.size() ? mbn[row] : averager.runningAverage(row);
+    }
+    // Mean |x| and RMS over the provisionalCount() rows (a pass over the unfinished ones)
+    void provisionalStats(double &meanAbs, double &rms) const;
+
+private:
+    ChannelAverager averager;
+    DoubleVector mbn;
+    DoubleVector env;
+    double sumAbs = 0.0;
+    double sumSq = 0.0;
+    StreamingIIRFilter lowpass;
+};
+
+// Causal: the low-pass runs forward only, as the rigs' original detector (peaks are
+// delayed by the filter's group delay). ZeroPhase: forward-backward filtering
+// (IIRFilter::applyZeroPhase), which keeps peak positions and widths in place.
+enum class EnvelopeMode {
+    Causal,
+    ZeroPhase
+};
+
+MBNMatrix extractEnvelopes(const MBNMatrix &mbnMatrix, EnvelopeMode mode = EnvelopeMode::Causal);
+// Square -> lowpass -> sqrt with a caller-designed filter, e.g. envelopeLowpass(4, ...)
+MBNMatrix extractEnvelopes(const MBNMatrix &mbnMatrix, const IIRFilter &lowpass,
+                           EnvelopeMode mode = EnvelopeMode::Causal);
+// Butterworth low-pass of the given order for the envelope detector
+IIRFilter envelopeLowpass(int order, double cutoffHz, double fs);
+
+// Envelopes of several signals, all sampled at fs
+struct EnvelopeMatrix {
+    MBNMatrix samples;
+    double fs = 0.0;
+};
+
+// Largest decimation factor that keeps the reduced Nyquist frequency (which is also the
+// decimator's anti-alias cut-off) this many times above the envelope bandwidth
+const double kDecimationMargin = 1.25;
+// floor(fs / (2 * cutoffHz * kDecimationMargin)), at least 1: 200 at the rigs' 100 kHz
+int maxEnvelopeDecimation(double fs, double cutoffHz = kEnvelopeCutoffHz);
+
+// Multi-rate envelope detector: square, anti-aliased decimation by `decimation` (see
+// FIRDecimator), 2nd-order Butterworth low-pass at the reduced rate, square root. fs is
+// the rate of the MBN signals; the envelopes are decimation times shorter and sampled at
+// fs / decimation, which the result carries. A factor above
+// maxEnvelopeDecimation(fs, cutoffHz) is clamped to it (with a warning), since the
+// low-pass could not be designed at the reduced rate.
+EnvelopeMatrix extractEnvelopesMultirate(const MBNMatrix &mbnMatrix, double fs, int decimation,
+                                         EnvelopeMode mode = EnvelopeMode::Causal,
+                                         double cutoffHz = kEnvelopeCutoffHz);
+
+// Hilbert (analytic-signal) envelope: FFT, negative frequencies zeroed, inverse FFT,
+// magnitude. Transforms use cached kiss_fft plans (fftplan.h) at a 2/3/5-smooth size,
+// and two signals of equal length share one forward transform. With smoothingHz > 0 the
+// instantaneous power is smoothed by a zero-phase 2nd-order Butterworth at fs before the
+// root. The result is 2*|analytic signal|, the scale of the square-law detector, so
+// amplitudes compare between the two methods.
+MBNMatrix extractEnvelopesHilbert(const MBNMatrix &mbnMatrix, double fs = kDefaultMBNSampleRate,
+                                  double smoothingHz = 0.0);
+
+// Sliding-window RMS envelope, 2*sqrt(mean of 2*x^2) over a centred window sized so that
+// the moving average is 3 dB down at cutoffHz (about 0.443*fs/cutoffHz samples); the
+// window is cut short at the ends. Zero-phase, on the square-law detector's scale.
+MBNMatrix extractEnvelopesRMS(const MBNMatrix &mbnMatrix, double fs = kDefaultMBNSampleRate,
+                              double cutoffHz = kEnvelopeCutoffHz);
+// Peak-hold envelope: env = max(2*|x|, decay * previous env), decaying with a time
+// constant of 1/(2*pi*cutoffHz). Causal and cheap, but it follows the peaks of the
+// signal rather than its power, so on noise it reads above the other methods.
+MBNMatrix extractEnvelopesPeakHold(const MBNMatrix &mbnMatrix, double fs = kDefaultMBNSampleRate,
+                                   double cutoffHz = kEnvelopeCutoffHz);
+
+// Fused causal envelope detector: env = 2*sqrt(max(0, lowpass(2*mbn^2))) computed block by
+// block in a single streaming pass, straight into the caller's n-sample env buffer. The
+// output is bit-identical to separate square, filter and sqrt passes.
+void envelopeInto(const IIRFilter &lowpass, const double *mbn, double *env, int n);
+// Same for every signal of mbn; env is resized to match (reusing its buffers when the
+// sizes already agree). Equal-length signals run kBiquadLanes at a time in SIMD lanes.
+void envelopesInto(const IIRFilter &lowpass, const MBNMatrix &mbn, MBNMatrix &env);
+// 打印每路包络的峰值特征（幅值、FWHM、幅宽比）及振铃次数
+void analyzeAllPeaks(const MBNMatrix &envelopes,
+                     double fs = 100000.0,
+                     double minProminenceRatio = 0.2,
+                     double ringingThresholdRatio = 0.01);
+QVector<double> butterworthFilter(const QVector<double> &x, double cutoffHz, double fs);
+
+
+// Prominence of every sample: its height above the higher of the lowest points between it
+// and the nearest sample at least as high on either side (0 at a rising last point).
+// Computed for the whole signal in O(N).
+QVector<double> peakProminences(const QVector<double> &signal);
+
+// 下面两个要用 QVector<double> 和你 MainWindow 里传的一致
+QVector<PeakInfo> findPeaksWithWidth(const QVector<double> &signal,
+                                    double fs,
+                                    double minProminenceRatio);
+// The k highest of those peaks (ties: leftmost first), highest first; k <= 0 returns them
+// all, in signal order. Candidates that cannot make the top k are skipped before their
+// prominence and width are computed.
+QVector<PeakInfo> findTopPeaksWithWidth(const QVector<double> &signal, double fs,
+                                        double minProminenceRatio, int k);
+int countRingingByPeaks(const QVector<double> &x,
+                          double thresholdRatio);
+// Same with an absolute threshold, for callers that already know max |x|
+int countRingingAbove(const double *x, int n, double threshold);
+
+// Mean/RMS/ringing of the MBN signal and the peaks of its envelope, as shown in MainWindow;
+// maxPeaks > 0 keeps only that many of the highest peaks (see findTopPeaksWithWidth)
+SignalFeatures computeSignalFeatures(const DoubleVector &mbn,
+                                     const DoubleVector &envelope,
+                                     double fs = 100000.0,
+                                     int maxPeaks = 0);
+
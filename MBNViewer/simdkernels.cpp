@@ -0,0 +1,625 @@
+#include "simdkernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  define MBN_SIMD_X86 1
+#  include <immintrin.h>
+#  if defined(_MSC_VER) && !defined(__clang__)
+#    include <intrin.h>
+#    define MBN_TARGET_AVX2
+#    define MBN_TARGET_SSE2
+#  else
+#    define MBN_TARGET_AVX2 __attribute__((target("avx2")))
+#    define MBN_TARGET_SSE2 __attribute__((target("sse2")))
+#  endif
+#else
+#  define MBN_SIMD_X86 0
+#endif
+
+static SimdLevel probeSimdLevel()
+{
+#if MBN_SIMD_X86
+#  if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    if (avx2) return SimdLevel::AVX2;
+    if (sse2) return SimdLevel::SSE2;
+#  else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+#  endif
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel detectedSimdLevel()
+{
+    static const SimdLevel level = probeSimdLevel();
+    return level;
+}
+
+static std::atomic<int> activeLevel{ -1 };
+
+SimdLevel activeSimdLevel()
+{
+    const int level = activeLevel.load(std::memory_order_relaxed);
+    return level < 0 ? detectedSimdLevel() : SimdLevel(level);
+}
+
+void setActiveSimdLevel(SimdLevel level)
+{
+    activeLevel.store(int(std::min(level, detectedSimdLevel())), std::memory_order_relaxed);
+}
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::Scalar: break;
+    }
+    return "scalar";
+}
+
+// —————————————— Channel averaging ——————————————
+
+static void averageScalar(const double *raw, int rows, int cols, double *out, int begin, int end)
+{
+    for (int i = begin; i < end; ++i) {
+        double sum = 0.0;
+        for (int j = 0; j < cols; ++j)
+            sum += raw[std::ptrdiff_t(j) * rows + i];
+        out[i] = sum / cols;
+    }
+}
+
+#if MBN_SIMD_X86
+MBN_TARGET_SSE2
+static void averageSSE2(const double *raw, int rows, int cols, double *out)
+{
+    const __m128d div = _mm_set1_pd(double(cols));
+    int i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        for (int j = 0; j < cols; ++j) {
+            const double *p = raw + std::ptrdiff_t(j) * rows + i;
+            s0 = _mm_add_pd(s0, _mm_loadu_pd(p));
+            s1 = _mm_add_pd(s1, _mm_loadu_pd(p + 2));
+        }
+        _mm_storeu_pd(out + i, _mm_div_pd(s0, div));
+        _mm_storeu_pd(out + i + 2, _mm_div_pd(s1, div));
+    }
+    averageScalar(raw, rows, cols, out, i, rows);
+}
+
+MBN_TARGET_AVX2
+static void averageAVX2(const double *raw, int rows, int cols, double *out)
+{
+    const __m256d div = _mm256_set1_pd(double(cols));
+    int i = 0;
+    for (; i + 16 <= rows; i += 16) {
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+        for (int j = 0; j < cols; ++j) {
+            const double *p = raw + std::ptrdiff_t(j) * rows + i;
+            s0 = _mm256_add_pd(s0, _mm256_loadu_pd(p));
+            s1 = _mm256_add_pd(s1, _mm256_loadu_pd(p + 4));
+            s2 = _mm256_add_pd(s2, _mm256_loadu_pd(p + 8));
+            s3 = _mm256_add_pd(s3, _mm256_loadu_pd(p + 12));
+        }
+        _mm256_storeu_pd(out + i,      _mm256_div_pd(s0, div));
+        _mm256_storeu_pd(out + i + 4,  _mm256_div_pd(s1, div));
+        _mm256_storeu_pd(out + i + 8,  _mm256_div_pd(s2, div));
+        _mm256_storeu_pd(out + i + 12, _mm256_div_pd(s3, div));
+    }
+    for (; i + 4 <= rows; i += 4) {
+        __m256d s = _mm256_setzero_pd();
+        for (int j = 0; j < cols; ++j)
+            s = _mm256_add_pd(s, _mm256_loadu_pd(raw + std::ptrdiff_t(j) * rows + i));
+        _mm256_storeu_pd(out + i, _mm256_div_pd(s, div));
+    }
+    averageScalar(raw, rows, cols, out, i, rows);
+}
+#endif
+
+void averageRepeatBlocks(const double *raw, int rows, int cols, double *out, SimdLevel level)
+{
+    if (rows <= 0 || cols <= 0)
+        return;
+#if MBN_SIMD_X86
+    if (level == SimdLevel::AVX2) { averageAVX2(raw, rows, cols, out); return; }
+    if (level == SimdLevel::SSE2) { averageSSE2(raw, rows, cols, out); return; }
+#endif
+    (void)level;
+    averageScalar(raw, rows, cols, out, 0, rows);
+}
+
+void averageRepeatBlocks(const double *raw, int rows, int cols, double *out)
+{
+    averageRepeatBlocks(raw, rows, cols, out, activeSimdLevel());
+}
+
+// —————————————— Block accumulation ——————————————
+
+#if MBN_SIMD_X86
+MBN_TARGET_SSE2
+static int accumulateSSE2(double *acc, const double *x, int n)
+{
+    int i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(acc + i, _mm_add_pd(_mm_loadu_pd(acc + i), _mm_loadu_pd(x + i)));
+    return i;
+}
+
+MBN_TARGET_AVX2
+static int accumulateAVX2(double *acc, const double *x, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(acc + i,     _mm256_add_pd(_mm256_loadu_pd(acc + i),     _mm256_loadu_pd(x + i)));
+        _mm256_storeu_pd(acc + i + 4, _mm256_add_pd(_mm256_loadu_pd(acc + i + 4), _mm256_loadu_pd(x + i + 4)));
+    }
+    return i;
+}
+#endif
+
+void accumulateBlock(double *acc, const double *x, int n, SimdLevel level)
+{
+    int i = 0;
+#if MBN_SIMD_X86
+    if (level == SimdLevel::AVX2) i = accumulateAVX2(acc, x, n);
+    else if (level == SimdLevel::SSE2) i = accumulateSSE2(acc, x, n);
+#endif
+    (void)level;
+    for (; i < n; ++i)
+        acc[i] += x[i];
+}
+
+void accumulateBlock(double *acc, const double *x, int n)
+{
+    accumulateBlock(acc, x, n, activeSimdLevel());
+}
+
+// —————————————— Biquad cascade across signals ——————————————
+
+static void biquadLanesScalar(const double *c, int sections, double *x, int n, double *state)
+{
+    for (int s = 0; s < sections; ++s, c += 5, state += 2 * kBiquadLanes) {
+        const double b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+        double *s1 = state, *s2 = state + kBiquadLanes;
+        for (int i = 0; i < n; ++i) {
+            double *v = x + std::ptrdiff_t(i) * kBiquadLanes;
+            for (int l = 0; l < kBiquadLanes; ++l) {
+                const double in = v[l];
+                const double y = b0 * in + s1[l];
+                s1[l] = b1 * in - a1 * y + s2[l];
+                s2[l] = b2 * in - a2 * y;
+                v[l] = y;
+            }
+        }
+    }
+}
+
+#if MBN_SIMD_X86
+MBN_TARGET_SSE2
+static void biquadLanesSSE2(const double *c, int sections, double *x, int n, double *state)
+{
+    for (int s = 0; s < sections; ++s, c += 5, state += 2 * kBiquadLanes) {
+        const __m128d b0 = _mm_set1_pd(c[0]), b1 = _mm_set1_pd(c[1]), b2 = _mm_set1_pd(c[2]);
+        const __m128d a1 = _mm_set1_pd(c[3]), a2 = _mm_set1_pd(c[4]);
+        __m128d s1[4], s2[4];
+        for (int k = 0; k < 4; ++k) {
+            s1[k] = _mm_loadu_pd(state + 2 * k);
+            s2[k] = _mm_loadu_pd(state + kBiquadLanes + 2 * k);
+        }
+        for (int i = 0; i < n; ++i) {
+            double *v = x + std::ptrdiff_t(i) * kBiquadLanes;
+            for (int k = 0; k < 4; ++k) {
+                const __m128d in = _mm_loadu_pd(v + 2 * k);
+                const __m128d y = _mm_add_pd(_mm_mul_pd(b0, in), s1[k]);
+                s1[k] = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1, in), _mm_mul_pd(a1, y)), s2[k]);
+                s2[k] = _mm_sub_pd(_mm_mul_pd(b2, in), _mm_mul_pd(a2, y));
+                _mm_storeu_pd(v + 2 * k, y);
+            }
+        }
+        for (int k = 0; k < 4; ++k) {
+            _mm_storeu_pd(state + 2 * k, s1[k]);
+            _mm_storeu_pd(state + kBiquadLanes + 2 * k, s2[k]);
+        }
+    }
+}
+
+MBN_TARGET_AVX2
+static void biquadLanesAVX2(const double *c, int sections, double *x, int n, double *state)
+{
+    for (int s = 0; s < sections; ++s, c += 5, state += 2 * kBiquadLanes) {
+        const __m256d b0 = _mm256_set1_pd(c[0]), b1 = _mm256_set1_pd(c[1]), b2 = _mm256_set1_pd(c[2]);
+        const __m256d a1 = _mm256_set1_pd(c[3]), a2 = _mm256_set1_pd(c[4]);
+        __m256d s1a = _mm256_loadu_pd(state),     s1b = _mm256_loadu_pd(state + 4);
+        __m256d s2a = _mm256_loadu_pd(state + 8), s2b = _mm256_loadu_pd(state + 12);
+        for (int i = 0; i < n; ++i) {
+            double *v = x + std::ptrdiff_t(i) * kBiquadLanes;
+            const __m256d ina = _mm256_loadu_pd(v), inb = _mm256_loadu_pd(v + 4);
+            const __m256d ya = _mm256_add_pd(_mm256_mul_pd(b0, ina), s1a);
+            const __m256d yb = _mm256_add_pd(_mm256_mul_pd(b0, inb), s1b);
+            s1a = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(b1, ina), _mm256_mul_pd(a1, ya)), s2a);
+            s1b = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(b1, inb), _mm256_mul_pd(a1, yb)), s2b);
+            s2a = _mm256_sub_pd(_mm256_mul_pd(b2, ina), _mm256_mul_pd(a2, ya));
+            s2b = _mm256_sub_pd(_mm256_mul_pd(b2, inb), _mm256_mul_pd(a2, yb));
+            _mm256_storeu_pd(v, ya);
+            _mm256_storeu_pd(v + 4, yb);
+        }
+        _mm256_storeu_pd(state, s1a);
+        _mm256_storeu_pd(state + 4, s1b);
+        _mm256_storeu_pd(state + 8, s2a);
+        _mm256_storeu_pd(state + 12, s2b);
+    }
+}
+#endif
+
+void biquadCascadeLanes(const double *coeffs, int sections, double *x, int n, double *state,
+                        SimdLevel level)
+{
+    if (sections <= 0 || n <= 0)
+        return;
+#if MBN_SIMD_X86
+    if (level == SimdLevel::AVX2) { biquadLanesAVX2(coeffs, sections, x, n, state); return; }
+    if (level == SimdLevel::SSE2) { biquadLanesSSE2(coeffs, sections, x, n, state); return; }
+#endif
+    (void)level;
+    biquadLanesScalar(coeffs, sections, x, n, state);
+}
+
+void biquadCascadeLanes(const double *coeffs, int sections, double *x, int n, double *state)
+{
+    biquadCascadeLanes(coeffs, sections, x, n, state, activeSimdLevel());
+}
+
+// —————————————— Envelope root ——————————————
+
+#if MBN_SIMD_X86
+// maxpd returns its second operand when either is NaN, which gives std::max(0.0, x)
+MBN_TARGET_SSE2
+static int envelopeRootSSE2(double *x, int n)
+{
+    const __m128d zero = _mm_setzero_pd(), two = _mm_set1_pd(2.0);
+    int i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(x + i, _mm_mul_pd(two, _mm_sqrt_pd(_mm_max_pd(_mm_loadu_pd(x + i), zero))));
+    return i;
+}
+
+MBN_TARGET_AVX2
+static int envelopeRootAVX2(double *x, int n)
+{
+    const __m256d zero = _mm256_setzero_pd(), two = _mm256_set1_pd(2.0);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(x + i, _mm256_mul_pd(two, _mm256_sqrt_pd(_mm256_max_pd(_mm256_loadu_pd(x + i), zero))));
+    return i;
+}
+#endif
+
+void envelopeRoot(double *x, int n, SimdLevel level)
+{
+    int i = 0;
+#if MBN_SIMD_X86
+    if (level == SimdLevel::AVX2) i = envelopeRootAVX2(x, n);
+    else if (level == SimdLevel::SSE2) i = envelopeRootSSE2(x, n);
+#endif
+    (void)level;
+    for (; i < n; ++i)
+        x[i] = 2.0 * std::sqrt(std::max(0.0, x[i]));
+}
+
+void envelopeRoot(double *x, int n)
+{
+    envelopeRoot(x, n, activeSimdLevel());
+}
+
+// —————————————— Moment sums ——————————————
+
+// Partial sums per lane: |x|, d, d^2, d^3, d^4
+static const int kMomentLanes = 4;
+typedef double MomentLanes[5][kMomentLanes];
+
+static void momentsScalar(const double *x, int begin, int n, double shift, MomentLanes s,
+                          double &lo, double &hi)
+{
+    for (int i = begin; i < n; ++i) {
+        const int l = i % kMomentLanes;
+        const double v = x[i], d = v - shift, d2 = d * d;
+        s[0][l] += std::abs(v);
+        s[1][l] += d;
+        s[2][l] += d2;
+        s[3][l] += d2 * d;
+        s[4][l] += d2 * d2;
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    }
+}
+
+#if MBN_SIMD_X86
+// minpd/maxpd return their second operand when either is NaN, as std::min(lo, v) keeps lo
+MBN_TARGET_SSE2
+static int momentsSSE2(const double *x, int n, double shift, MomentLanes s, double &lo, double &hi)
+{
+    const __m128d sign = _mm_set1_pd(-0.0), k = _mm_set1_pd(shift);
+    __m128d acc[5][2];
+    for (int m = 0; m < 5; ++m)
+        acc[m][0] = acc[m][1] = _mm_setzero_pd();
+    __m128d mn = _mm_set1_pd(lo), mx = _mm_set1_pd(hi);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (int h = 0; h < 2; ++h) {
+            const __m128d v = _mm_loadu_pd(x + i + 2 * h);
+            const __m128d d = _mm_sub_pd(v, k), d2 = _mm_mul_pd(d, d);
+            acc[0][h] = _mm_add_pd(acc[0][h], _mm_andnot_pd(sign, v));
+            acc[1][h] = _mm_add_pd(acc[1][h], d);
+            acc[2][h] = _mm_add_pd(acc[2][h], d2);
+            acc[3][h] = _mm_add_pd(acc[3][h], _mm_mul_pd(d2, d));
+            acc[4][h] = _mm_add_pd(acc[4][h], _mm_mul_pd(d2, d2));
+            mn = _mm_min_pd(v, mn);
+            mx = _mm_max_pd(v, mx);
+        }
+    }
+    for (int m = 0; m < 5; ++m) {
+        _mm_storeu_pd(s[m], acc[m][0]);
+        _mm_storeu_pd(s[m] + 2, acc[m][1]);
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, mn);
+    lo = std::min(lanes[0], lanes[1]);
+    _mm_storeu_pd(lanes, mx);
+    hi = std::max(lanes[0], lanes[1]);
+    return i;
+}
+
+MBN_TARGET_AVX2
+static int momentsAVX2(const double *x, int n, double shift, MomentLanes s, double &lo, double &hi)
+{
+    const __m256d sign = _mm256_set1_pd(-0.0), k = _mm256_set1_pd(shift);
+    __m256d a = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd();
+    __m256d s3 = _mm256_setzero_pd(), s4 = _mm256_setzero_pd();
+    __m256d mn = _mm256_set1_pd(lo), mx = _mm256_set1_pd(hi);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d v = _mm256_loadu_pd(x + i);
+        const __m256d d = _mm256_sub_pd(v, k), d2 = _mm256_mul_pd(d, d);
+        a = _mm256_add_pd(a, _mm256_andnot_pd(sign, v));
+        s1 = _mm256_add_pd(s1, d);
+        s2 = _mm256_add_pd(s2, d2);
+        s3 = _mm256_add_pd(s3, _mm256_mul_pd(d2, d));
+        s4 = _mm256_add_pd(s4, _mm256_mul_pd(d2, d2));
+        mn = _mm256_min_pd(v, mn);
+        mx = _mm256_max_pd(v, mx);
+    }
+    _mm256_storeu_pd(s[0], a);
+    _mm256_storeu_pd(s[1], s1);
+    _mm256_storeu_pd(s[2], s2);
+    _mm256_storeu_pd(s[3], s3);
+    _mm256_storeu_pd(s[4], s4);
+    double lanes[4];
+    _mm256_storeu_pd(lanes, mn);
+    lo = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+    _mm256_storeu_pd(lanes, mx);
+    hi = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    return i;
+}
+#endif
+
+MomentSums momentSums(const double *x, int n, double shift, SimdLevel level)
+{
+    MomentLanes s = {};
+    double lo = std::numeric_limits<double>::infinity(), hi = -lo;
+    int i = 0;
+#if MBN_SIMD_X86
+    if (level == SimdLevel::AVX2) i = momentsAVX2(x, n, shift, s, lo, hi);
+    else if (level == SimdLevel::SSE2) i = momentsSSE2(x, n, shift, s, lo, hi);
+#endif
+    (void)level;
+    momentsScalar(x, i, n, shift, s, lo, hi);
+
+    MomentSums sums;
+    double *out[5] = { &sums.sumAbs, &sums.sum, &sums.sumSq, &sums.sumCube, &sums.sumQuad };
+    for (int m = 0; m < 5; ++m)
+        *out[m] = (s[m][0] + s[m][1]) + (s[m][2] + s[m][3]);
+    sums.min = lo;
+    sums.max = hi;
+    return sums;
+}
+
+MomentSums momentSums(const double *x, int n, double shift)
+{
+    return momentSums(x, n, shift, activeSimdLevel());
+}
+
+// —————————————— Local extrema ——————————————
+
+// The set lanes of a 4-lane compare mask. Two strict maxima (or minima) are never
+// neighbours, so an extremum mask has at most two lanes set.
+struct LaneBits {
+    unsigned char count, first, second;
+};
+static const LaneBits kLaneBits[16] = {
+    { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 2, 0, 1 },
+    { 1, 2, 0 }, { 2, 0, 2 }, { 2, 1, 2 }, { 3, 0, 1 },
+    { 1, 3, 0 }, { 2, 0, 3 }, { 2, 1, 3 }, { 3, 0, 1 },
+    { 2, 2, 3 }, { 3, 0, 2 }, { 3, 1, 2 }, { 4, 0, 1 },
+};
+
+static int localMaximaScalar(const double *x, int begin, int end, double threshold, int *index)
+{
+    int k = 0;
+    for (int i = begin; i < end; ++i) {
+        if (x[i] > x[i - 1] && x[i] > x[i + 1] && x[i] > threshold)
+            index[k++] = i;
+    }
+    return k;
+}
+
+static void countExtremaScalar(const double *x, int begin, int end, double threshold,
+                               int &maxima, int &minima)
+{
+    for (int i = begin; i < end; ++i) {
+        maxima += x[i] > x[i - 1] && x[i] > x[i + 1] && x[i] > threshold;
+        minima += x[i] < x[i - 1] && x[i] < x[i + 1] && x[i] < -threshold;
+    }
+}
+
+#if MBN_SIMD_X86
+// Each step compares the 4 samples from i on with both neighbours; the caller keeps
+// i + 4 < n so that x[i + 4] exists. cmpgt/cmplt are false for NaN, as in the scalar code.
+MBN_TARGET_SSE2
+static inline int maximaMaskSSE2(const double *x, int i, __m128d t)
+{
+    int mask = 0;
+    for (int h = 0; h < 2; ++h) {
+        const __m128d c = _mm_loadu_pd(x + i + 2 * h);
+        const __m128d up = _mm_and_pd(_mm_cmpgt_pd(c, _mm_loadu_pd(x + i + 2 * h - 1)),
+                                      _mm_cmpgt_pd(c, _mm_loadu_pd(x + i + 2 * h + 1)));
+        mask |= _mm_movemask_pd(_mm_and_pd(up, _mm_cmpgt_pd(c, t))) << (2 * h);
+    }
+    return mask;
+}
+
+MBN_TARGET_SSE2
+static int localMaximaSSE2(const double *x, int n, double threshold, int *index, int &i)
+{
+    const __m128d t = _mm_set1_pd(threshold);
+    int k = 0;
+    for (i = 1; i + 4 < n; i += 4) {
+        const LaneBits b = kLaneBits[maximaMaskSSE2(x, i, t)];
+        index[k] = i + b.first;
+        index[k + 1] = i + b.second;
+        k += b.count;
+    }
+    return k;
+}
+
+MBN_TARGET_SSE2
+static void countExtremaSSE2(const double *x, int n, double threshold, int &maxima, int &minima,
+                             int &i)
+{
+    const __m128d t = _mm_set1_pd(threshold), nt = _mm_set1_pd(-threshold);
+    for (i = 1; i + 4 < n; i += 4) {
+        int down = 0;
+        for (int h = 0; h < 2; ++h) {
+            const __m128d c = _mm_loadu_pd(x + i + 2 * h);
+            const __m128d l = _mm_loadu_pd(x + i + 2 * h - 1), r = _mm_loadu_pd(x + i + 2 * h + 1);
+            const __m128d low = _mm_and_pd(_mm_cmplt_pd(c, l), _mm_cmplt_pd(c, r));
+            down |= _mm_movemask_pd(_mm_and_pd(low, _mm_cmplt_pd(c, nt))) << (2 * h);
+        }
+        maxima += kLaneBits[maximaMaskSSE2(x, i, t)].count;
+        minima += kLaneBits[down].count;
+    }
+}
+
+MBN_TARGET_AVX2
+static inline int maximaMaskAVX2(const double *x, int i, __m256d t)
+{
+    const __m256d c = _mm256_loadu_pd(x + i);
+    const __m256d up = _mm256_and_pd(_mm256_cmp_pd(c, _mm256_loadu_pd(x + i - 1), _CMP_GT_OQ),
+                                     _mm256_cmp_pd(c, _mm256_loadu_pd(x + i + 1), _CMP_GT_OQ));
+    return _mm256_movemask_pd(_mm256_and_pd(up, _mm256_cmp_pd(c, t, _CMP_GT_OQ)));
+}
+
+MBN_TARGET_AVX2
+static int localMaximaAVX2(const double *x, int n, double threshold, int *index, int &i)
+{
+    const __m256d t = _mm256_set1_pd(threshold);
+    int k = 0;
+    for (i = 1; i + 8 < n; i += 8) {
+        const int lo = maximaMaskAVX2(x, i, t), hi = maximaMaskAVX2(x, i + 4, t);
+        if ((lo | hi) == 0)
+            continue;
+        const LaneBits a = kLaneBits[lo], b = kLaneBits[hi];
+        index[k] = i + a.first;
+        index[k + 1] = i + a.second;
+        k += a.count;
+        index[k] = i + 4 + b.first;
+        index[k + 1] = i + 4 + b.second;
+        k += b.count;
+    }
+    return k;
+}
+
+MBN_TARGET_AVX2
+static void countExtremaAVX2(const double *x, int n, double threshold, int &maxima, int &minima,
+                             int &i)
+{
+    const __m256d t = _mm256_set1_pd(threshold), nt = _mm256_set1_pd(-threshold);
+    // Lane counts are summed as vectors (0 or -1 per compare) and reduced once at the end
+    __m256i up = _mm256_setzero_si256(), down = _mm256_setzero_si256();
+    for (i = 1; i + 4 < n; i += 4) {
+        const __m256d c = _mm256_loadu_pd(x + i);
+        const __m256d l = _mm256_loadu_pd(x + i - 1), r = _mm256_loadu_pd(x + i + 1);
+        const __m256d isMax = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(c, l, _CMP_GT_OQ),
+                                                          _mm256_cmp_pd(c, r, _CMP_GT_OQ)),
+                                            _mm256_cmp_pd(c, t, _CMP_GT_OQ));
+        const __m256d isMin = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(c, l, _CMP_LT_OQ),
+                                                          _mm256_cmp_pd(c, r, _CMP_LT_OQ)),
+                                            _mm256_cmp_pd(c, nt, _CMP_LT_OQ));
+        up = _mm256_sub_epi64(up, _mm256_castpd_si256(isMax));
+        down = _mm256_sub_epi64(down, _mm256_castpd_si256(isMin));
+    }
+    long long lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), up);
+    maxima += int(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), down);
+    minima += int(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+#endif
+
+int localMaxima(const double *x, int n, double threshold, int *index, SimdLevel level)
+{
+    if (n < 3)
+        return 0;
+    int i = 1, k = 0;
+#if MBN_SIMD_X86
+    if (level == SimdLevel::AVX2) k = localMaximaAVX2(x, n, threshold, index, i);
+    else if (level == SimdLevel::SSE2) k = localMaximaSSE2(x, n, threshold, index, i);
+#endif
+    (void)level;
+    return k + localMaximaScalar(x, i, n - 1, threshold, index + k);
+}
+
+int localMaxima(const double *x, int n, double threshold, int *index)
+{
+    return localMaxima(x, n, threshold, index, activeSimdLevel());
+}
+
+void countLocalExtrema(const double *x, int n, double threshold, int &maxima, int &minima,
+                       SimdLevel level)
+{
+    maxima = minima = 0;
+    if (n < 3)
+        return;
+    int i = 1;
+#if MBN_SIMD_X86
+    if (level == SimdLevel::AVX2) countExtremaAVX2(x, n, threshold, maxima, minima, i);
+    else if (level == SimdLevel::SSE2) countExtremaSSE2(x, n, threshold, maxima, minima, i);
+#endif
+    (void)level;
+    countExtremaScalar(x, i, n - 1, threshold, maxima, minima);
+}
+
+void countLocalExtrema(const double *x, int n, double threshold, int &maxima, int &minima)
+{
+    countLocalExtrema(x, n, threshold, maxima, minima, activeSimdLevel());
+}
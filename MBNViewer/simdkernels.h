@@ -0,0 +1,74 @@
+#pragma once
+
+// Hand-vectorised kernels with AVX2 / SSE2 paths and a scalar fallback. The path is picked
+// once at runtime from the CPU; every path performs the same floating-point operations in
+// the same order as the scalar reference, so results are bit-identical across machines.
+
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Best level supported by this CPU/OS
+SimdLevel detectedSimdLevel();
+// Level used by the dispatching overloads (defaults to detectedSimdLevel(), never higher)
+SimdLevel activeSimdLevel();
+void setActiveSimdLevel(SimdLevel level);
+const char *simdLevelName(SimdLevel level);
+
+// out[i] = (0 + raw[i] + raw[rows + i] + ... + raw[(cols-1)*rows + i]) / cols
+// raw is channel-major (cols blocks of rows samples); the blocks are summed as
+// contiguous vectors (16 rows per step, one stream per block) instead of with a stride
+// of `rows`.
+void averageRepeatBlocks(const double *raw, int rows, int cols, double *out);
+void averageRepeatBlocks(const double *raw, int rows, int cols, double *out, SimdLevel level);
+
+// acc[i] += x[i]
+void accumulateBlock(double *acc, const double *x, int n);
+void accumulateBlock(double *acc, const double *x, int n, SimdLevel level);
+
+// Signals filtered side by side by biquadCascadeLanes: one per double lane of two AVX2
+// registers (two independent recursions per instruction stream hide the add latency)
+const int kBiquadLanes = 8;
+
+// Runs a cascade of biquads over kBiquadLanes interleaved signals, in place: x[i * 8 + l]
+// is sample i of signal l. coeffs holds {b0, b1, b2, a1, a2} per section; state holds
+// {s1[8], s2[8]} per section (transposed direct form II) and is updated. Every lane gets
+// exactly the operations of IIRFilter::filter, so each signal is bit-identical to it.
+void biquadCascadeLanes(const double *coeffs, int sections, double *x, int n, double *state);
+void biquadCascadeLanes(const double *coeffs, int sections, double *x, int n, double *state,
+                        SimdLevel level);
+
+// x[i] = 2 * sqrt(max(0, x[i])), the root step of the envelope detector (a NaN becomes 0,
+// as with std::max(0.0, x))
+void envelopeRoot(double *x, int n);
+void envelopeRoot(double *x, int n, SimdLevel level);
+
+// Power sums of x[0 .. n) about shift (d = x[i] - shift), taken in one pass. Sample i is
+// summed into partial sum i % 4 and the partials are added as (0 + 1) + (2 + 3).
+struct MomentSums {
+    double sumAbs = 0.0;    // sum of |x|
+    double sum = 0.0;       // sum of d
+    double sumSq = 0.0;     // d^2
+    double sumCube = 0.0;   // d^3
+    double sumQuad = 0.0;   // d^4
+    double min = 0.0;       // of x; +inf / -inf when n is 0
+    double max = 0.0;
+};
+
+MomentSums momentSums(const double *x, int n, double shift);
+MomentSums momentSums(const double *x, int n, double shift, SimdLevel level);
+
+// Strict interior local maxima of x[0 .. n): every i in [1, n - 1) with
+// x[i - 1] < x[i] > x[i + 1] and x[i] > threshold, written to index in ascending order.
+// Returns how many. The vector paths write past the last entry, so index needs room for
+// n / 2 + 2 entries. A flat top has no strict maximum and is never reported.
+int localMaxima(const double *x, int n, double threshold, int *index);
+int localMaxima(const double *x, int n, double threshold, int *index, SimdLevel level);
+
+// Counts of the strict interior maxima above threshold and of the strict interior minima
+// (x[i - 1] > x[i] < x[i + 1]) below -threshold
+void countLocalExtrema(const double *x, int n, double threshold, int &maxima, int &minima);
+void countLocalExtrema(const double *x, int n, double threshold, int &maxima, int &minima,
+                       SimdLevel level);
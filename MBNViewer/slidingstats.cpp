@@ -0,0 +1,149 @@
+#include "slidingstats.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+// Last input sample inside the window of output j is j + lead
+static int windowLead(int window, WindowAlignment alignment)
+{
+    return alignment == WindowAlignment::Centred ? window / 2 : 0;
+}
+
+void slidingMoments(const double *x, int n, int window, WindowAlignment alignment,
+                    double *mean, double *meanSquare)
+{
+    if (n <= 0)
+        return;
+    if (window < 1) {
+        qWarning() << "Invalid sliding window:" << window;
+        window = 1;
+    }
+    const int lead = windowLead(window, alignment);
+    const int first = std::min(n, std::max(0, window - 1 - lead));   // first full window
+    const int last = n - 1 - lead;                                    // last one not cut at the end
+
+    // Windows cut at the start, [0, j + lead]: the sums only grow
+    double sum = 0.0, sumSq = 0.0;
+    int hi = -1;
+    for (int j = 0; j < first; ++j) {
+        for (; hi < std::min(n - 1, j + lead); ++hi) {
+            sum += x[hi + 1];
+            sumSq += x[hi + 1] * x[hi + 1];
+        }
+        mean[j] = sum / (hi + 1);
+        meanSquare[j] = sumSq / (hi + 1);
+    }
+
+    // Full windows: one sample enters and one leaves per output. Each stretch of
+    // kSlidingRenormalise outputs starts from sums taken exactly over its first window.
+    const int stretch = std::max(kSlidingRenormalise, window);
+    const double scale = 1.0 / window;
+    for (int j0 = first; j0 <= last; j0 += stretch) {
+        sum = sumSq = 0.0;
+        for (int k = j0 + lead - window + 1; k <= j0 + lead; ++k) {
+            sum += x[k];
+            sumSq += x[k] * x[k];
+        }
+        mean[j0] = sum * scale;
+        meanSquare[j0] = sumSq * scale;
+
+        const int j1 = std::min(last, j0 + stretch - 1);
+        for (int j = j0 + 1; j <= j1; ++j) {
+            const double in = x[j + lead], out = x[j + lead - window];
+            sum += in - out;
+            sumSq += in * in - out * out;
+            mean[j] = sum * scale;
+            meanSquare[j] = sumSq * scale;
+        }
+    }
+
+    // Windows cut at the end, [j + lead - window + 1, n - 1]: walked backwards so that
+    // the sums again only grow
+    sum = sumSq = 0.0;
+    int lo = n;
+    for (int j = n - 1; j >= std::max(first, last + 1); --j) {
+        for (; lo > std::max(0, j + lead - window + 1); --lo) {
+            sum += x[lo - 1];
+            sumSq += x[lo - 1] * x[lo - 1];
+        }
+        mean[j] = sum / (n - lo);
+        meanSquare[j] = sumSq / (n - lo);
+    }
+}
+
+void slidingMax(const double *x, int n, int window, WindowAlignment alignment, double *max)
+{
+    if (n <= 0)
+        return;
+    if (window < 1) {
+        qWarning() << "Invalid sliding window:" << window;
+        window = 1;
+    }
+    const int lead = windowLead(window, alignment);
+
+    // The signal is cut into blocks of `window` samples. A window ending at hi spans the
+    // block of hi and at most the one before it, so its maximum is the larger of the
+    // running maximum of hi's block up to hi and the suffix maximum of the previous block
+    // from the window's first sample on. Only two blocks of suffix maxima are kept.
+    QVector<double> previousSuffix(window), blockSuffix(window);
+    int blockStart = 0;
+    double blockMax = x[0];
+    for (; blockStart < n; blockStart += window) {
+        const int blockEnd = std::min(n, blockStart + window);
+        double *suffix = blockSuffix.data();
+        suffix[blockEnd - 1 - blockStart] = x[blockEnd - 1];
+        for (int k = blockEnd - 2; k >= blockStart; --k)
+            suffix[k - blockStart] = x[k] > suffix[k + 1 - blockStart] ? x[k] : suffix[k + 1 - blockStart];
+
+        // Outputs whose window ends inside this block and is not cut at the end
+        const double *before = previousSuffix.constData();   // sample lo at lo - blockStart + window
+        blockMax = x[blockStart];
+        for (int hi = blockStart; hi < blockEnd; ++hi) {
+            blockMax = x[hi] > blockMax ? x[hi] : blockMax;
+            const int j = hi - lead;
+            if (j < 0)
+                continue;
+            const int lo = hi - window + 1;
+            if (lo >= 0 && lo < blockStart) {
+                const double b = before[lo - blockStart + window];
+                max[j] = b > blockMax ? b : blockMax;
+            } else {
+                max[j] = blockMax;
+            }
+        }
+        if (blockEnd < n)
+            previousSuffix.swap(blockSuffix);
+        else
+            break;
+    }
+
+    // Windows cut at the end, [lo, n - 1]: blockSuffix holds the last block (starting at
+    // blockStart, with maximum blockMax) and previousSuffix the one before it
+    for (int j = std::max(0, n - lead); j < n; ++j) {
+        const int lo = std::max(0, j + lead - window + 1);
+        if (lo >= blockStart)
+            max[j] = blockSuffix[lo - blockStart];
+        else
+            max[j] = std::max(previousSuffix[lo - blockStart + window], blockMax);
+    }
+}
+
+WindowedStats slidingWindowStats(const QVector<double> &x, int window, WindowAlignment alignment)
+{
+    const int n = x.size();
+    WindowedStats stats;
+    stats.mean.resize(n);
+    stats.rms.resize(n);
+    stats.variance.resize(n);
+    stats.max.resize(n);
+
+    // rms holds the mean square until the roots are taken
+    slidingMoments(x.constData(), n, window, alignment, stats.mean.data(), stats.rms.data());
+    for (int j = 0; j < n; ++j) {
+        const double meanSquare = std::max(0.0, stats.rms[j]);
+        stats.variance[j] = std::max(0.0, meanSquare - stats.mean[j] * stats.mean[j]);
+        stats.rms[j] = std::sqrt(meanSquare);
+    }
+    slidingMax(x.constData(), n, window, alignment, stats.max.data());
+    return stats;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <QVector>
+
+// Where the window of output sample j sits: Trailing covers x[j-window+1 .. j] (a causal
+// feature track), Centred covers x[j-(window-1)/2 .. j+window/2] (no delay, as an
+// envelope). Windows are cut short at the ends of the signal and the statistics use the
+// samples they do cover.
+enum class WindowAlignment {
+    Trailing,
+    Centred
+};
+
+// Sliding mean and mean square of n samples, one value per sample, in O(1) per sample:
+// running sums updated by the sample entering and the one leaving the window, taken
+// afresh from the window every kSlidingRenormalise outputs (or every window, if longer)
+// so that rounding cannot accumulate over long signals.
+void slidingMoments(const double *x, int n, int window, WindowAlignment alignment,
+                    double *mean, double *meanSquare);
+// Sliding maximum in O(1) per sample independent of the window (van Herk / Gil-Werman:
+// block-wise running and suffix maxima, three comparisons per sample)
+void slidingMax(const double *x, int n, int window, WindowAlignment alignment, double *max);
+
+const int kSlidingRenormalise = 8192;
+
+// Windowed statistics of one signal as tracks over time
+struct WindowedStats {
+    QVector<double> mean;
+    QVector<double> rms;
+    QVector<double> variance;   // population variance, E[x^2] - E[x]^2 clamped at 0
+    QVector<double> max;
+};
+
+WindowedStats slidingWindowStats(const QVector<double> &x, int window,
+                                 WindowAlignment alignment = WindowAlignment::Trailing);
@@ -0,0 +1,201 @@
+#include "streamingpeaks.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+StreamingPeakDetector::StreamingPeakDetector(double fs, double minProminence, int lookback)
+{
+    reset(fs, minProminence, lookback);
+}
+
+void StreamingPeakDetector::reset(double sampleRate, double minProminence, int lookbackSamples)
+{
+    fs = sampleRate;
+    minProm = minProminence;
+    lookback = std::max(1, lookbackSamples);
+    t = 0;
+    prev1 = prev2 = lastRunMin = 0.0;
+    dropped = 0;
+    prominenceStack.clear();
+    prominenceBottom = 0;
+    lowStack.clear();
+    lowBottom = 0;
+    records.clear();
+    firstId = 0;
+    pending.clear();
+    crossings = {};
+}
+
+void StreamingPeakDetector::process(const double *x, int n, QVector<Peak> &confirmed)
+{
+    for (int k = 0; k < n; ++k)
+        push(x[k], confirmed);
+}
+
+void StreamingPeakDetector::push(double v, QVector<Peak> &confirmed)
+{
+    // x[t-1] is a strict maximum now that its right neighbour is known
+    if (t >= 2 && prev1 > prev2 && prev1 > v)
+        detect(t - 1, prev1, lastRunMin, v, confirmed);
+
+    // Right-hand sides. A pending peak is settled as prominent once the signal is far
+    // enough below it (the highest, oldest ones first) and rejected when the run of lower
+    // samples ends without that (the lowest, newest ones first)
+    while (!pending.empty() && record(pending.front()).value - v >= minProm) {
+        Record &r = record(pending.front());
+        pending.pop_front();
+        r.state = State::Prominent;
+        emitIfReady(r, confirmed);
+    }
+    while (!pending.empty() && !(v < record(pending.back()).value)) {
+        record(pending.back()).state = State::Done;
+        pending.pop_back();
+    }
+    // Right half-maximum crossings, as the scan `while (x[R] > half) ++R`
+    while (!crossings.empty() && !(v > crossings.top().first)) {
+        const qint64 id = crossings.top().second;
+        crossings.pop();
+        if (id < firstId)
+            continue;
+        Record &r = record(id);
+        if (r.state != State::Done && r.right < 0) {
+            r.right = t;
+            emitIfReady(r, confirmed);
+        }
+    }
+
+    // Left-hand history: the left base of v (peakProminences' left pass) and the suffix
+    // minima used for left crossings (lastAtOrBelow)
+    double runMin = v;
+    while (prominenceStack.size() > prominenceBottom && prominenceStack.last().value < v) {
+        runMin = std::min(runMin, prominenceStack.last().runMin);
+        prominenceStack.removeLast();
+    }
+    prominenceStack.append({ v, runMin, t });
+    // (a NaN is ranked as -inf: like the scan `while (x[L] > half)`, the crossing stops there)
+    const double low = std::isnan(v) ? -std::numeric_limits<double>::infinity() : v;
+    while (lowStack.size() > lowBottom && lowStack.last().value >= low)
+        lowStack.removeLast();
+    lowStack.append({ low, low, t });
+
+    lastRunMin = runMin;
+    prev2 = prev1;
+    prev1 = v;
+    ++t;
+    evict();
+}
+
+void StreamingPeakDetector::detect(qint64 i, double peak, double minLeft, double next,
+                                   QVector<Peak> &confirmed)
+{
+    // Rejected outright when even the deepest right-hand base cannot make it prominent
+    if (peak - minLeft < minProm)
+        return;
+
+    Record r;
+    r.position = i;
+    r.value = peak;
+    r.half = peak / 2.0;
+    r.right = -1;
+    r.state = peak - std::max(minLeft, next) >= minProm ? State::Prominent : State::Pending;
+
+    r.left = leftCrossing(r.half);
+    if (!(peak > r.half))
+        r.right = i;
+
+    const qint64 id = firstId + qint64(records.size());
+    records.push_back(r);
+    if (r.state == State::Pending)
+        pending.push_back(id);
+    if (r.right < 0)
+        crossings.emplace(r.half, id);
+    emitIfReady(records.back(), confirmed);
+}
+
+qint64 StreamingPeakDetector::leftCrossing(double half) const
+{
+    // Last sample at or below half so far (the newest suffix minimum at or below it),
+    // else the start of the remembered history
+    const auto bottom = lowStack.cbegin() + lowBottom;
+    const auto above = std::upper_bound(bottom, lowStack.cend(), half,
+                                        [](double level, const StackEntry &e) { return level < e.value; });
+    return above == bottom ? std::max<qint64>(0, t - lookback) : (above - 1)->position;
+}
+
+void StreamingPeakDetector::emitIfReady(Record &r, QVector<Peak> &confirmed)
+{
+    if (r.state != State::Prominent || r.right < 0)
+        return;
+    const double widthSec = double(r.right - r.left) / fs;
+    confirmed << Peak{ r.position, { r.value, widthSec, r.value / widthSec } };
+    r.state = State::Done;
+}
+
+void StreamingPeakDetector::evictStack(QVector<StackEntry> &stack, int &bottom, qint64 horizon)
+{
+    while (bottom < stack.size() && stack[bottom].position < horizon)
+        ++bottom;
+    if (bottom > 64 && 2 * bottom > stack.size()) {
+        stack.remove(0, bottom);
+        bottom = 0;
+    }
+}
+
+void StreamingPeakDetector::evict()
+{
+    const qint64 horizon = t - lookback;
+    evictStack(prominenceStack, prominenceBottom, horizon);
+    evictStack(lowStack, lowBottom, horizon);
+
+    // Settled peaks leave from the front; one unsettled for longer than the lookback is
+    // dropped (it is also the front of `pending`, if it is pending)
+    while (!records.empty()) {
+        Record &r = records.front();
+        if (r.state != State::Done) {
+            if (r.position >= horizon)
+                break;
+            if (!pending.empty() && pending.front() == firstId)
+                pending.pop_front();
+            r.state = State::Done;
+            ++dropped;
+        }
+        records.pop_front();
+        ++firstId;
+    }
+
+    // Crossings of rejected peaks stay in the heap until they pop; rebuild it once they
+    // outnumber the live entries
+    if (crossings.size() > 2 * records.size() + 64) {
+        decltype(crossings) live;
+        for (std::size_t k = 0; k < records.size(); ++k) {
+            if (records[k].state != State::Done && records[k].right < 0)
+                live.emplace(records[k].half, firstId + qint64(k));
+        }
+        crossings = std::move(live);
+    }
+}
+
+void StreamingPeakDetector::finish(QVector<Peak> &confirmed)
+{
+    // The right-hand runs end with the signal: what is still pending is not prominent, and
+    // the crossings not seen are at the last sample
+    for (qint64 id : pending)
+        record(id).state = State::Done;
+    pending.clear();
+    for (Record &r : records) {
+        if (r.state == State::Prominent && r.right < 0) {
+            r.right = t - 1;
+            emitIfReady(r, confirmed);
+        }
+    }
+
+    // A rising last point: nothing to its right, so its prominence is 0
+    if (t >= 3 && prev1 > prev2 && prev1 - std::max(lastRunMin, prev1) >= minProm) {
+        const double widthSec = double(t - 1 - leftCrossing(prev1 / 2.0)) / fs;
+        confirmed << Peak{ t - 1, { prev1, widthSec, prev1 / widthSec } };
+    }
+
+    records.clear();
+    firstId = 0;
+    crossings = {};
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <QVector>
+#include <deque>
+#include <queue>
+#include <utility>
+#include "signalprocessor.h"
+
+// findPeaksWithWidth for an envelope that arrives in chunks. A peak is reported once its
+// prominence is settled (the signal has dropped far enough below it, or the run of lower
+// samples on its right has ended) and its right half-maximum crossing has been seen;
+// usually a few samples after the crossing.
+//
+// The prominence threshold is absolute (findPeaksWithWidth uses minProminenceRatio times
+// the global maximum, which is not known until the end). Only the last `lookback`
+// samples are remembered: left-hand searches do not reach further back, and a peak still
+// unsettled after lookback samples is dropped. As long as every peak's bases and
+// half-maximum crossings lie within the lookback, the peaks are exactly those of
+// findPeaksWithWidth with the same threshold, but in the order they are confirmed.
+class StreamingPeakDetector {
+public:
+    struct Peak {
+        qint64 position;   // sample index
+        PeakInfo info;
+    };
+
+    StreamingPeakDetector() = default;
+    StreamingPeakDetector(double fs, double minProminence, int lookback);
+    void reset(double fs, double minProminence, int lookback);
+
+    // Applies from the next sample on; peaks already settled keep their verdict
+    void setMinProminence(double minProminence) { minProm = minProminence; }
+    double minProminence() const { return minProm; }
+
+    // Feeds n samples; peaks they confirm are appended to confirmed
+    void process(const double *x, int n, QVector<Peak> &confirmed);
+    // End of the signal: settles the peaks still waiting for their right-hand side
+    void finish(QVector<Peak> &confirmed);
+
+    qint64 sampleCount() const { return t; }
+    // Peaks given up because they stayed unsettled for longer than the lookback
+    int droppedCount() const { return dropped; }
+
+private:
+    enum class State {
+        Pending,     // prominence not known yet
+        Prominent,   // waiting for the right half-maximum crossing
+        Done         // reported, rejected or dropped
+    };
+    struct Record {
+        qint64 position;
+        double value;
+        double half;
+        qint64 left;
+        qint64 right;   // -1 until the crossing is seen
+        State state;
+    };
+    // Entry of the left-pass stack of peakProminences (values never increase from bottom
+    // to top) or of the suffix minima (runMin unused)
+    struct StackEntry {
+        double value;
+        double runMin;
+        qint64 position;
+    };
+
+    Record &record(qint64 id) { return records[std::size_t(id - firstId)]; }
+    void push(double v, QVector<Peak> &confirmed);
+    void detect(qint64 i, double peak, double minLeft, double next, QVector<Peak> &confirmed);
+    static void evictStack(QVector<StackEntry> &stack, int &bottom, qint64 horizon);
+    qint64 leftCrossing(double half) const;
+    void emitIfReady(Record &r, QVector<Peak> &confirmed);
+    void evict();
+
+    double fs = 1.0;
+    double minProm = 0.0;
+    int lookback = 0;
+
+    qint64 t = 0;                 // samples seen
+    double prev1 = 0.0;           // x[t-1]
+    double prev2 = 0.0;           // x[t-2]
+    double lastRunMin = 0.0;      // left base of x[t-1]
+    int dropped = 0;
+
+    // Both stacks lose entries older than the lookback from the bottom, which is the
+    // index `...Bottom`; the storage is compacted once half of it is dead
+    QVector<StackEntry> prominenceStack;
+    int prominenceBottom = 0;
+    // Suffix minima of the samples (strictly increasing values), for the left crossing
+    QVector<StackEntry> lowStack;
+    int lowBottom = 0;
+
+    std::deque<Record> records;   // every peak found and not yet settled, in order
+    qint64 firstId = 0;
+    std::deque<qint64> pending;   // Pending peaks, oldest (and highest) first
+    std::priority_queue<std::pair<double, qint64>> crossings;   // {half, id}, highest first
+};